@@ -10,23 +10,32 @@
 #include <map>
 #include <SDL2/SDL_ttf.h>
 #include "captions.hpp"
+#include "glyph_atlas.hpp"
+#include "caption_cache.hpp"
+#include "asset_manager.hpp"
+#include "playback_clock.hpp"
+#include "session_table.hpp"
 
 struct AppContext {
     SDL_Renderer *renderer;
     SDL_Texture *texture;
     SDL_mutex *mutex;
-    std::mutex *azimuth_mutex;
-    std::deque<float> *azimuth_buffer;
+    SessionTable *sessions; // The display follows the primary session's orientation
+    int64_t presentation_delay; // nanoseconds from composing a frame to it being on screen
     TTF_Font *smallest_font;
     TTF_Font *medium_font;
     TTF_Font *largest_font;
     const std::map<cog::Juror, std::pair<double, double>> *juror_positions;
     const std::map<cog::Juror, TTF_Font *> *juror_font_sizes;
-    SDL_Surface *back_arrow;
-    SDL_Surface *forward_arrow;
+    const std::map<TTF_Font *, GlyphAtlas *> *font_atlases;
+    const Asset *back_arrow;
+    const Asset *forward_arrow;
     const SDL_Color *foreground_color;
     const SDL_Color *background_color;
     CaptionModel *caption_model;
+    CaptionSnapshot *caption_snapshot;
+    CaptionTextureCache *caption_cache;
+    PlaybackClock *playback_clock;
     int presentation_method;
     int n;
     int y;
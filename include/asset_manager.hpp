@@ -0,0 +1,61 @@
+#ifndef COG_GROUP_CONVO_CPP_ASSET_MANAGER_HPP
+#define COG_GROUP_CONVO_CPP_ASSET_MANAGER_HPP
+
+#include <map>
+#include <string>
+#include <SDL2/SDL.h>
+
+/**
+ * An image, uploaded to the renderer as a texture. Its texture may be replaced when the renderer is reset, so hold on
+ * to the Asset rather than to the texture.
+ */
+struct Asset {
+    SDL_Texture *texture;
+    int w;
+    int h;
+};
+
+/**
+ * Loads images from disk once and keeps them as textures on the renderer, so drawing one every frame is a single
+ * SDL_RenderCopy. The decoded images are kept in memory too, so the textures can be uploaded again if the renderer
+ * loses them.
+ */
+class AssetManager {
+private:
+    struct Entry {
+        SDL_Surface *surface;
+        Asset asset;
+    };
+
+    SDL_Renderer *renderer;
+    // Keyed by path. Map nodes never move, so the Assets handed out stay valid as more images are loaded.
+    std::map<std::string, Entry> entries;
+
+public:
+    /**
+     * @param renderer The renderer the images will be drawn on
+     */
+    explicit AssetManager(SDL_Renderer *renderer);
+
+    ~AssetManager();
+
+    AssetManager(const AssetManager &) = delete;
+
+    AssetManager &operator=(const AssetManager &) = delete;
+
+    /**
+     * Loads the image at the given path and uploads it as a texture. Loading the same path twice returns the same
+     * asset.
+     * @param path The path of the image to load
+     * @return The loaded asset, which belongs to the manager, or nullptr if it couldn't be loaded.
+     */
+    const Asset *load(const std::string &path);
+
+    /**
+     * Uploads every image again. Call this when the renderer reports that its textures were lost
+     * (SDL_RENDER_DEVICE_RESET), while nothing is being drawn.
+     */
+    void reload();
+};
+
+#endif //COG_GROUP_CONVO_CPP_ASSET_MANAGER_HPP
@@ -0,0 +1,98 @@
+#ifndef COG_GROUP_CONVO_CPP_CAPTION_CACHE_HPP
+#define COG_GROUP_CONVO_CPP_CAPTION_CACHE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "captions.hpp"
+#include "glyph_atlas.hpp"
+
+/**
+ * Everything that determines what a rendered caption looks like.
+ */
+struct CaptionTextureKey {
+    uint64_t generation;
+    TTF_Font *font;
+    SDL_Color foreground_color;
+    SDL_Color background_color;
+    int wrap_width;
+
+    bool operator==(const CaptionTextureKey &other) const;
+};
+
+/**
+ * Rendered captions, kept as textures for as long as they're on screen.
+ * Captions only change a few times a second, so most frames can draw the texture of the previous frame instead of
+ * rendering the text again. Every word is a new caption, though, which is never drawn again once the next one has
+ * replaced it, so once the cache is full, a miss renders into the least recently used texture of the same size rather
+ * than creating one. Textures are as wide as the wrap width, whatever the caption's width, so that captions with the
+ * same number of lines share a size; only when none does is the least recently used texture destroyed.
+ * A texture holds its caption on its background, with the colors premultiplied by alpha, and is drawn with a blend mode
+ * for that, so a translucent background is blended onto the frame once, exactly as it is when drawn straight from the
+ * glyph atlas.
+ */
+class CaptionTextureCache {
+private:
+    struct Entry {
+        CaptionTextureKey key;
+        SDL_Texture *texture;
+        int width;
+        int height;
+        uint64_t last_used;
+    };
+
+    std::vector<Entry> entries;
+    size_t capacity;
+    // Cleared if the renderer can't draw premultiplied textures, and nothing is cached from then on.
+    bool usable = true;
+    uint64_t clock = 0;
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint64_t reuse_count = 0;
+
+    /**
+     * @return A texture for a caption to be rendered into, set up to be drawn premultiplied, or nullptr if it couldn't
+     * be created.
+     */
+    SDL_Texture *create_texture(SDL_Renderer *renderer, int width, int height);
+
+public:
+    explicit CaptionTextureCache(size_t capacity);
+
+    ~CaptionTextureCache();
+
+    CaptionTextureCache(const CaptionTextureCache &) = delete;
+
+    CaptionTextureCache &operator=(const CaptionTextureCache &) = delete;
+
+    /**
+     * Returns a texture of the given caption, rendering it if it isn't cached yet.
+     * The caption is in the top-left snapshot->width by snapshot->height pixels of the texture, which may be wider and
+     * is transparent past the caption. The texture belongs to the cache.
+     * @param renderer The renderer the texture will be drawn on. It must support render targets.
+     * @param atlas The glyph atlas of the font to render the caption in
+     * @param key Identifies the caption (and how it's drawn)
+     * @param snapshot The caption to be rendered on a miss
+     * @return The caption's texture, or nullptr if it couldn't be rendered, in which case draw the caption without the
+     * cache.
+     */
+    SDL_Texture *get(SDL_Renderer *renderer, GlyphAtlas *atlas, const CaptionTextureKey &key,
+                     const CaptionSnapshot *snapshot);
+
+    /**
+     * Destroys every cached texture.
+     */
+    void clear();
+
+    uint64_t hits() const;
+
+    uint64_t misses() const;
+
+    /**
+     * @return How many misses were rendered into a texture that was already there, rather than a new one.
+     */
+    uint64_t reuses() const;
+};
+
+#endif //COG_GROUP_CONVO_CPP_CAPTION_CACHE_HPP
@@ -0,0 +1,98 @@
+#ifndef COG_GROUP_CONVO_CPP_CAPTION_TRACK_HPP
+#define COG_GROUP_CONVO_CPP_CAPTION_TRACK_HPP
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "cog-flatbuffer-definitions/caption_message_generated.h"
+
+/**
+ * One word of a compiled caption track.
+ */
+struct CaptionEvent {
+    double time; // milliseconds since the start of the video section
+    uint32_t text_offset; // into the track's text pool
+    uint32_t text_length; // not counting the NUL that follows the text in the pool
+    int32_t message_id;
+    int32_t chunk_id;
+    int8_t speaker; // a cog::Juror
+    uint8_t padding[7];
+};
+static_assert(sizeof(CaptionEvent) == 32, "CaptionEvent is written to disk as-is");
+
+/**
+ * The header at the start of a compiled caption track. The file is laid out as the header, then event_count
+ * CaptionEvents, then text_pool_size bytes of NUL-terminated text. Everything is in the host's byte order; the
+ * magic number doesn't match on a host with the other one.
+ */
+struct CaptionTrackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t event_count;
+    uint32_t text_pool_size;
+};
+
+/**
+ * A caption track compiled ahead of time from merged_captions.N.json (see tools/caption_compiler.cpp), and memory-mapped
+ * in place. Loading it doesn't parse anything, and playing it back is iterating over an array.
+ */
+class CaptionTrack {
+private:
+    void *mapping;
+    size_t mapping_size;
+    const CaptionEvent *events;
+    uint32_t event_count;
+    const char *text_pool;
+
+    CaptionTrack(void *mapping, size_t mapping_size);
+
+public:
+    constexpr static uint32_t MAGIC = 0x54474F43; // "COGT"
+    constexpr static uint32_t VERSION = 1;
+
+    /**
+     * Maps the compiled track at the given path, and checks that it's well-formed.
+     * @return The track, or nullptr if it couldn't be opened or is malformed.
+     */
+    static std::unique_ptr<CaptionTrack> open(const std::string &path);
+
+    ~CaptionTrack();
+
+    CaptionTrack(const CaptionTrack &) = delete;
+
+    CaptionTrack &operator=(const CaptionTrack &) = delete;
+
+    const CaptionEvent *begin() const;
+
+    const CaptionEvent *end() const;
+
+    size_t size() const;
+
+    /**
+     * @return The text of one of this track's events. It's NUL-terminated, and lives as long as the track.
+     */
+    std::string_view text(const CaptionEvent &event) const;
+
+    cog::Juror speaker(const CaptionEvent &event) const;
+};
+
+/**
+ * Compiles a caption track from its JSON form: an array of {"text", "message_id", "chunk_id", "delay", "speaker_id"},
+ * where "delay" is the time of the word in milliseconds since the start of the section.
+ * The JSON is streamed, not parsed into a DOM, so this works in memory proportional to the track for any length of
+ * transcript.
+ * @param caption_json The contents of merged_captions.N.json
+ * @param path Where to write the compiled track
+ * @return Whether the track was written.
+ */
+bool compile_caption_track(std::istream &caption_json, const std::string &path);
+
+/**
+ * @param juror_str A caption's "speaker_id", e.g. "juror-a"
+ * @throws std::invalid_argument If juror_str doesn't name a juror.
+ */
+cog::Juror juror_from_string(const std::string &juror_str);
+
+#endif //COG_GROUP_CONVO_CPP_CAPTION_TRACK_HPP
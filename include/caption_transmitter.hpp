@@ -0,0 +1,35 @@
+#ifndef COG_GROUP_CONVO_CPP_CAPTION_TRANSMITTER_HPP
+#define COG_GROUP_CONVO_CPP_CAPTION_TRANSMITTER_HPP
+
+#include <string>
+#include "cog-flatbuffer-definitions/caption_message_generated.h"
+#include "network_shards.hpp"
+
+/**
+ * Sends CaptionMessages to the HWD. One builder is kept for the life of the transmitter and cleared between messages,
+ * so once it has grown to fit the longest word, sending doesn't allocate. Each datagram is exactly as long as the
+ * message in it.
+ * A transmitter isn't thread-safe: each thread that sends captions should have its own.
+ */
+class CaptionTransmitter {
+private:
+    constexpr static size_t INITIAL_BUFFER_SIZE = 1024;
+
+    NetworkShards *network;
+    flatbuffers::FlatBufferBuilder builder{INITIAL_BUFFER_SIZE};
+
+public:
+    /**
+     * @param network The shards that will send the captions to the HWDs
+     */
+    explicit CaptionTransmitter(NetworkShards *network);
+
+    /**
+     * Serializes one word of the captions, and queues it to be sent. This doesn't wait for the socket.
+     * @return Whether the datagram was queued.
+     */
+    bool transmit(const std::string &text, cog::Juror speaker_id, cog::Juror focused_id, int message_id,
+                  int chunk_id);
+};
+
+#endif //COG_GROUP_CONVO_CPP_CAPTION_TRANSMITTER_HPP
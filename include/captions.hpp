@@ -5,32 +5,95 @@
 #ifndef COG_GROUP_CONVO_CPP_CAPTIONS_HPP
 #define COG_GROUP_CONVO_CPP_CAPTIONS_HPP
 
+#include <array>
+#include <atomic>
+#include <map>
 #include <vector>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <netinet/in.h>
+#include "text_layout.hpp"
+#include "caption_track.hpp"
+#include "playback_clock.hpp"
+#include "caption_transmitter.hpp"
 #include "cog-flatbuffer-definitions/caption_message_generated.h"
-#include "nlohmann/json.hpp"
 
+/**
+ * A copy of the captions currently on display: who is speaking, the last two wrapped lines of what they've said,
+ * the size (in pixels) of the box those lines fill in the speaker's font, and the generation of the CaptionModel
+ * it was taken from.
+ */
+struct CaptionSnapshot {
+    cog::Juror juror = cog::Juror_JuryForeman;
+    std::string text;
+    int width = 0;
+    int height = 0;
+    uint64_t generation = 0;
+};
 
+/**
+ * Holds what the current speaker has said, wrapped for display. Lines are broken by their pixel width in the
+ * speaker's font, so every caption box is at most LINE_WIDTH pixels wide whatever font the juror is shown in.
+ *
+ * Words are added by the caption thread and read by the VLC render callback. The two never share a lock: the
+ * model publishes snapshots through a triple buffer, so add_word never waits for a frame to finish and
+ * get_current_text never waits for a word to be added. This only holds for ONE writer thread and ONE reader thread.
+ */
 class CaptionModel {
 private:
-    std::vector<std::pair<cog::Juror, std::string>> spoken_so_far;
-    std::mutex text_mutex;
-    const static int LINE_LENGTH = 30;
+    // Who said the words on display, if anyone has spoken yet. What they said is only kept in the two lines below, so
+    // the model's memory is bounded however long they speak.
+    std::optional<cog::Juror> current_speaker;
+    const std::map<cog::Juror, const GlyphMetrics *> *juror_metrics;
+
+    // The two most recent wrapped lines of the current speaker, kept up to date as words arrive.
+    // Only the last line is ever re-measured: appending a word either extends it or starts a new one.
+    std::string previous_line;
+    std::string current_line;
+    int previous_line_width = 0;
+    int current_line_width = 0;
+    uint64_t generation = 0;
+
+    // Triple buffer of snapshots. The writer owns snapshots[back], the reader owns snapshots[front], and the third
+    // slot is handed between them through `middle`, which also carries a flag saying it holds an unread snapshot.
+    constexpr static uint8_t INDEX_MASK = 0x3;
+    constexpr static uint8_t FRESH = 0x4;
+    std::array<CaptionSnapshot, 3> snapshots;
+    uint8_t back = 0;
+    std::atomic<uint8_t> middle{1};
+    uint8_t front = 2;
 
-    static std::string wrap(const std::string &text, int line_length);
+    void append_to_lines(const std::string &new_word, const GlyphMetrics *metrics);
+
+    void publish(cog::Juror speaker, const GlyphMetrics *metrics);
 
 public:
-    explicit CaptionModel() = default;
+    const static int LINE_WIDTH = 400; // pixels
+
+    /**
+     * @param juror_metrics The glyph metrics of the font each juror's captions are displayed in.
+     */
+    explicit CaptionModel(const std::map<cog::Juror, const GlyphMetrics *> *juror_metrics);
 
+    /**
+     * Appends a word to the captions. Must only be called from the caption thread.
+     * @param new_word The word that was just spoken
+     * @param speaker Who spoke it. A change of speaker clears the captions.
+     */
     void add_word(const std::string &new_word, cog::Juror speaker);
 
-    std::pair<cog::Juror, std::string> get_current_text(int line_length = LINE_LENGTH);
+    /**
+     * Copies the current captions into the given snapshot. If the snapshot is already at the model's generation,
+     * nothing is copied, so calling this every frame costs O(1) and doesn't allocate between words.
+     * This never blocks, but must only be called from the render thread.
+     * @param snapshot The caller's snapshot, refreshed in place.
+     */
+    void get_current_text(CaptionSnapshot *snapshot);
 };
 
-cog::Juror juror_from_string(const std::string &juror_str);
-
 void
-start_caption_stream(int socket, sockaddr_in* client_address, std::mutex *socket_mutex, nlohmann::json *caption_json,
-                     CaptionModel *model);
+start_caption_stream(NetworkShards *network, const CaptionTrack *track, CaptionModel *model,
+                     PlaybackClock *playback_clock);
 
 #endif //COG_GROUP_CONVO_CPP_CAPTIONS_HPP
@@ -5,33 +5,63 @@
 #ifndef COG_GROUP_CONVO_CPP_EXPERIMENT_SETUP_HPP
 #define COG_GROUP_CONVO_CPP_EXPERIMENT_SETUP_HPP
 
+#include <string>
 #include <tuple>
+#include <vector>
 #include <netinet/in.h>
 #include <getopt.h>
 #include <SDL2/SDL.h>
+#include "network_reactor.hpp"
+#include "orientation_estimators.hpp"
 
 /**
  * Prints a QR code to the console. The QR code's contents are formatted as follows:
- * "<MACHINE_IP_ADDR>:<PORT> <PRESENTATION_METHOD>"
+ * "<MACHINE_IP_ADDR>:<PORT> <PRESENTATION_METHOD>", followed by " <GROUP_ADDR>:<GROUP_PORT>" if captions are multicast.
  * @param presentation_method
+ * @param multicast_group Where captions are multicast, or empty if they aren't
  */
-void print_connection_qr(int presentation_method, int port);
+void print_connection_qr(int presentation_method, int port, const std::string &multicast_group = "");
 
 std::tuple<int, sockaddr_in> connect_to_client(int port);
 
+/**
+ * Binds count sockets to the port, sharing it with SO_REUSEPORT if there's more than one.
+ */
+std::vector<int> connect_to_clients(int port, size_t count);
+
 
 SDL_Color color_string_to_color(const std::string &color_str);
 
+/**
+ * Parses an IPv4 address and port, as "<ADDR>:<PORT>".
+ * @return Whether the string was a valid address.
+ */
+bool address_from_string(const std::string &address_str, sockaddr_in *address);
+
 static struct option long_options[] = {
         {"video_section",       required_argument, nullptr, 'v'},
         {"presentation_method", required_argument, nullptr, 'm'},
         {"foreground_color",    required_argument, nullptr, 'f'},
         {"background_color",    required_argument, nullptr, 'b'},
         {"path_to_font",        required_argument, nullptr, 'p'},
-        {"font_size",           required_argument, nullptr, 's'}
+        {"font_size",           required_argument, nullptr, 's'},
+        {"network_backend",     required_argument, nullptr, 'n'},
+        {"receive_threads",     required_argument, nullptr, 'r'},
+        {"multicast_group",     required_argument, nullptr, 'g'},
+        {"multicast_interface", required_argument, nullptr, 'i'},
+        {"orientation_filter",  required_argument, nullptr, 'o'},
+        {nullptr,               0,                 nullptr, 0}
 };
 
-std::tuple<int, int, SDL_Color, SDL_Color, std::string, int>
+/**
+ * Parses the command-line arguments. --network_backend is optional, and is epoll or io_uring (epoll by default).
+ * --receive_threads is optional, and is how many sharded threads receive from the HWDs (one by default).
+ * --multicast_group is optional, and is the "<ADDR>:<PORT>" to multicast captions to, instead of sending them to each
+ * HWD. --multicast_interface is the address of the interface to multicast from (the default route's by default).
+ * --orientation_filter is optional, and is boxcar, one_euro or kalman (boxcar by default).
+ */
+std::tuple<int, int, SDL_Color, SDL_Color, std::string, int, NetworkBackend, int, std::string, std::string,
+        OrientationFilterType>
 parse_arguments(int argc, char *argv[]);
 
 #endif //COG_GROUP_CONVO_CPP_EXPERIMENT_SETUP_HPP
@@ -0,0 +1,25 @@
+#ifndef COG_GROUP_CONVO_CPP_FRAME_CONTEXT_HPP
+#define COG_GROUP_CONVO_CPP_FRAME_CONTEXT_HPP
+
+#include <SDL2/SDL.h>
+#include "AppContext.hpp"
+
+/**
+ * Where the head is pointing for one frame, and where that puts things on screen. It's taken once as each frame is
+ * composed and handed to the presentation method, so everything drawn in a frame agrees on the pose, and the trig is
+ * done once rather than by every piece that needs it.
+ */
+struct FrameContext {
+    double azimuth; // radians, extrapolated to when the frame will be on screen
+    int azimuth_x; // the window position the head points at
+    SDL_Rect fov_region; // the part of the window a realistic HWD would show, from the top to the bottom
+    SDL_Rect caption_rect; // where the current caption goes when pinned under its juror, at its full size
+};
+
+/**
+ * Samples the primary HWD's orientation for the frame being composed, and lays out the frame's geometry around it.
+ * @param context The app context, whose caption snapshot has already been updated for this frame
+ */
+FrameContext capture_frame_context(const AppContext *context);
+
+#endif //COG_GROUP_CONVO_CPP_FRAME_CONTEXT_HPP
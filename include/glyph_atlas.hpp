@@ -0,0 +1,79 @@
+#ifndef COG_GROUP_CONVO_CPP_GLYPH_ATLAS_HPP
+#define COG_GROUP_CONVO_CPP_GLYPH_ATLAS_HPP
+
+#include <array>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "text_layout.hpp"
+
+/**
+ * Every printable ASCII glyph of a font, rasterized once into a single texture.
+ * Text is drawn as one batch of textured quads (one for the background, one per glyph), so drawing captions every
+ * frame doesn't rasterize anything or upload any textures.
+ */
+class GlyphAtlas {
+private:
+    constexpr static int FIRST_GLYPH = ' ';
+    constexpr static int LAST_GLYPH = '~';
+    constexpr static int ATLAS_WIDTH = 512;
+    // A block of opaque white texels, used to draw the background behind the text in the same batch as the glyphs.
+    // It's a few texels wide so that linear filtering at its center never samples a neighbouring glyph.
+    constexpr static int SOLID_BLOCK_SIZE = 4;
+
+    const GlyphMetrics *metrics;
+    // The rasterized glyphs, kept so that they can be uploaded again if the renderer loses its textures.
+    SDL_Surface *surface = nullptr;
+    SDL_Texture *texture = nullptr;
+    int texture_width = 0;
+    int texture_height = 0;
+    std::array<SDL_Rect, LAST_GLYPH - FIRST_GLYPH + 1> glyph_rects{};
+    SDL_Rect solid_rect{};
+
+    // Reused between draws, so that drawing doesn't allocate once the longest caption has been seen.
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    const SDL_Rect &glyph_rect(char c) const;
+
+    void add_quad(const SDL_Rect &destination, const SDL_Rect &source, const SDL_Color &color);
+
+    void upload(SDL_Renderer *renderer);
+
+public:
+    /**
+     * Rasterizes the font's glyphs and uploads them as a texture on the given renderer.
+     * @param renderer The renderer the text will be drawn on
+     * @param metrics The metrics of the font to rasterize, which must outlive the atlas.
+     */
+    GlyphAtlas(SDL_Renderer *renderer, const GlyphMetrics *metrics);
+
+    ~GlyphAtlas();
+
+    GlyphAtlas(const GlyphAtlas &) = delete;
+
+    GlyphAtlas &operator=(const GlyphAtlas &) = delete;
+
+    /**
+     * Uploads the glyphs again. Call this when the renderer reports that its textures were lost
+     * (SDL_RENDER_DEVICE_RESET), while nothing is being drawn.
+     * @param renderer The renderer the atlas was created on
+     */
+    void reload(SDL_Renderer *renderer);
+
+    /**
+     * Draws (possibly multi-line) text on its background with a single SDL_RenderGeometry call.
+     * Returns the width and height of the drawn box.
+     * @param renderer The renderer the atlas was created on
+     * @param text The text to draw. Lines are separated by '\n'.
+     * @param x The x location of the top-left corner of the box
+     * @param y The y location of the top-left corner of the box
+     * @param foreground_color The color of the text
+     * @param background_color The color of the box behind the text
+     */
+    std::tuple<int, int> render_text(SDL_Renderer *renderer, const std::string &text, int x, int y,
+                                     const SDL_Color *foreground_color, const SDL_Color *background_color);
+};
+
+#endif //COG_GROUP_CONVO_CPP_GLYPH_ATLAS_HPP
@@ -0,0 +1,115 @@
+#ifndef COG_GROUP_CONVO_CPP_IO_URING_RING_HPP
+#define COG_GROUP_CONVO_CPP_IO_URING_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <time.h>
+#include <linux/io_uring.h>
+
+// Only in the kernel headers of Linux 5.19 and later.
+struct io_uring_buf_ring;
+
+/**
+ * Just enough of io_uring for the network reactor, set up through the kernel's interface directly rather than liburing:
+ * a submission queue, a completion queue, and a ring of buffers registered with the kernel, which multishot receives
+ * fill without a buffer being handed over for each one.
+ * Needs Linux 6.0 or later, for multishot recvmsg, and its kernel headers to build. Without them,
+ * HAVE_IO_URING_MULTISHOT isn't defined, and create() always fails. Not thread-safe: it belongs to the thread that
+ * submits to it.
+ */
+class IoUringRing {
+private:
+    int ring_fd = -1;
+
+    void *submission_mapping = nullptr;
+    size_t submission_mapping_size = 0;
+    void *completion_mapping = nullptr;
+    size_t completion_mapping_size = 0;
+    io_uring_sqe *submission_entries = nullptr;
+    size_t submission_entries_size = 0;
+
+    unsigned *submission_head = nullptr;
+    unsigned *submission_tail = nullptr;
+    unsigned submission_mask = 0;
+    unsigned *submission_array = nullptr;
+    // Submissions that have been queued, but not handed to the kernel yet.
+    unsigned pending = 0;
+
+    unsigned *completion_head = nullptr;
+    unsigned *completion_tail = nullptr;
+    unsigned completion_mask = 0;
+    io_uring_cqe *completion_entries = nullptr;
+
+    io_uring_buf_ring *buffer_ring = nullptr;
+    size_t buffer_ring_size = 0;
+    uint8_t *buffers = nullptr;
+    size_t buffer_size = 0;
+    unsigned buffer_count = 0;
+    uint16_t buffer_tail = 0;
+
+    IoUringRing() = default;
+
+    bool map_rings(const io_uring_params &params);
+
+    bool supports_multishot_receive() const;
+
+    bool register_buffers(unsigned count, size_t size);
+
+    bool enter(unsigned min_complete, const timespec *timeout);
+
+public:
+    // The buffer group that receives should select their buffers from.
+    constexpr static uint16_t BUFFER_GROUP = 0;
+
+    /**
+     * Sets up a ring and registers its buffers.
+     * @param entries How many submissions can be queued at once
+     * @param buffer_count How many receive buffers to register, a power of two
+     * @param buffer_size How large each receive buffer is
+     * @return The ring, or nullptr if io_uring isn't available, or is too old to receive in multishot.
+     */
+    static std::unique_ptr<IoUringRing> create(unsigned entries, unsigned buffer_count, size_t buffer_size);
+
+    ~IoUringRing();
+
+    IoUringRing(const IoUringRing &) = delete;
+
+    IoUringRing &operator=(const IoUringRing &) = delete;
+
+    /**
+     * @return A zeroed submission to fill in, which is handed to the kernel by the next wait(). If the queue is full,
+     * what's in it is submitted first.
+     */
+    io_uring_sqe *submission();
+
+    /**
+     * Submits everything queued, then waits until there's at least one completion, or the timeout passes.
+     * @param timeout How long to wait, or nullptr to wait indefinitely
+     * @return Whether the wait ended normally: with completions, on the timeout, on a signal, or because the kernel
+     * couldn't take the submissions yet, which are kept to submit next time. false means the ring is unusable.
+     */
+    bool wait(const timespec *timeout);
+
+    /**
+     * @return The oldest completion that hasn't been consumed, or nullptr if there isn't one.
+     */
+    const io_uring_cqe *completion();
+
+    /**
+     * Consumes the completion returned by completion().
+     */
+    void consume();
+
+    /**
+     * @return The registered buffer with the given ID, as picked by the kernel for a receive.
+     */
+    uint8_t *buffer(uint16_t id);
+
+    /**
+     * Hands a buffer back to the kernel to receive into again.
+     */
+    void recycle(uint16_t id);
+};
+
+#endif //COG_GROUP_CONVO_CPP_IO_URING_RING_HPP
@@ -0,0 +1,254 @@
+#ifndef COG_GROUP_CONVO_CPP_NETWORK_REACTOR_HPP
+#define COG_GROUP_CONVO_CPP_NETWORK_REACTOR_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include "orientation_sample.hpp"
+#include "session_table.hpp"
+#include "retransmit_window.hpp"
+#include "io_uring_ring.hpp"
+
+/**
+ * How the network reactor waits for and receives datagrams.
+ */
+enum class NetworkBackend {
+    // epoll, reading with recvmmsg.
+    Epoll,
+    // io_uring, with a multishot receive into registered buffers. Falls back to epoll where it isn't available, or
+    // wasn't built in because the kernel headers were older than Linux 6.0, and if the ring fails while running.
+    IoUring,
+};
+
+/**
+ * Owns the UDP socket shared with the HWDs, and does all of its I/O on one thread, with epoll or io_uring.
+ * Inbound OrientationMessages are stamped with the kernel's receive time, checked against the sequence of their
+ * session, and handed to a callback along with the session of the HWD that sent them as they arrive. With epoll, what's
+ * queued on the socket is read in batches of RECEIVE_BATCH datagrams per system call, up to MAX_RECEIVE_BATCHES before
+ * the reactor sends what's queued and comes back for the rest; with io_uring, the kernel receives into registered
+ * buffers on its own, and one system call collects whatever has arrived.
+ * Outbound datagrams are queued by any thread and sent by the reactor to every session, through the one socket.
+ * When the port is shared by several NetworkShards, each reactor only handles the sessions of its own shard.
+ * Captions can instead be sent once to a multicast group that the HWDs have joined, whatever the number of HWDs. Only
+ * retransmits, and any other datagrams, are still sent to each HWD.
+ * Captions are kept in a RetransmitWindow, and sent again to HWDs that acknowledge captions but missed one.
+ * Every MAINTENANCE_TICK, the reactor disconnects its HWDs that have gone quiet, so their slots can be reused.
+ * Nothing holds a lock while it waits on the socket, so sending captions never waits for the next orientation packet.
+ * This uses epoll and eventfd, so it's Linux-only.
+ */
+class NetworkReactor {
+public:
+    constexpr static size_t MAX_DATAGRAM_SIZE = 1024;
+    constexpr static size_t QUEUE_CAPACITY = 256;
+    // How many datagrams are read with each recvmmsg, and handed over together at most.
+    constexpr static size_t RECEIVE_BATCH = 64;
+    // How many batches are read per wakeup at most, so that a flood of orientations can't hold up sending captions.
+    constexpr static size_t MAX_RECEIVE_BATCHES = 4;
+    // How many buffers are registered with io_uring. The kernel drops datagrams when they're all in use.
+    constexpr static unsigned IO_URING_BUFFERS = 256;
+    constexpr static unsigned IO_URING_ENTRIES = 16;
+    // How often idle sessions are looked for, when nothing else wakes the reactor.
+    constexpr static auto MAINTENANCE_TICK = std::chrono::milliseconds(250);
+
+    using OrientationHandler = std::function<void(Session *session, const OrientationSample *samples, size_t count)>;
+
+private:
+    struct Datagram {
+        bool reliable;
+        uint64_t key; // The caption_key of a reliable datagram
+        size_t size;
+        std::array<uint8_t, MAX_DATAGRAM_SIZE> data;
+    };
+
+    int socket;
+    size_t shard;
+    // Read by other threads, and changed by the reactor if io_uring fails while it's running.
+    std::atomic<NetworkBackend> backend;
+    int epoll_fd = -1;
+    std::unique_ptr<IoUringRing> ring;
+    // Written to wake the reactor when there's something to send, or when it should stop.
+    int wake_fd;
+    OrientationHandler on_orientation;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    SessionTable *sessions;
+
+    // Only touched by the reactor thread.
+    bool waiting_to_write = false;
+    // The next session to send the datagram at the front of the queue to, if sending it was interrupted, and whether
+    // it has been sent to any session yet, and if not, whether this shard has any sessions to send it to.
+    size_t next_recipient = 0;
+    bool front_sent = false;
+    bool front_addressed = false;
+    std::array<std::array<uint8_t, MAX_DATAGRAM_SIZE>, RECEIVE_BATCH> receive_buffers{};
+    std::array<iovec, RECEIVE_BATCH> receive_vectors{};
+    std::array<sockaddr_in, RECEIVE_BATCH> receive_senders{};
+    std::array<std::array<char, CMSG_SPACE(sizeof(timespec))>, RECEIVE_BATCH> receive_controls{};
+    std::array<mmsghdr, RECEIVE_BATCH> receive_headers{};
+    std::array<OrientationSample, RECEIVE_BATCH> received_samples{};
+    // The session that the samples in received_samples came from.
+    Session *batch_session = nullptr;
+    size_t batch_size = 0;
+    // What io_uring's multishot receive fills in, besides the payload: where each buffer's name and control go.
+    msghdr io_uring_receive_header{};
+    uint64_t receive_calls = 0;
+    uint64_t received = 0;
+    // Datagrams from an HWD whose session belongs to another shard.
+    uint64_t misrouted = 0;
+    uint64_t send_calls = 0;
+    // Where captions are sent, if they're multicast, and whether this reactor is the one that sends them there.
+    bool multicast = false;
+    bool multicast_sender = false;
+    sockaddr_in multicast_group{};
+    RetransmitWindow retransmit_window;
+    RetransmitWindow::clock::time_point next_retransmit;
+    RetransmitWindow::clock::time_point next_maintenance;
+
+    // Outbound datagrams, in a fixed ring so that queueing them doesn't allocate. The mutex only guards the ring;
+    // it's never held during a system call.
+    std::mutex queue_mutex;
+    std::array<Datagram, QUEUE_CAPACITY> queue;
+    size_t queue_head = 0;
+    size_t queue_size = 0;
+    std::atomic<uint64_t> dropped{0};
+
+    bool set_up_epoll();
+
+    bool set_up_io_uring();
+
+    void run();
+
+    void run_epoll();
+
+    void run_io_uring();
+
+    void submit_io_uring_receive();
+
+    void submit_io_uring_wake();
+
+    void submit_io_uring_writable();
+
+    void receive_completion(const io_uring_cqe &completion);
+
+    void receive_all();
+
+    void receive(const sockaddr_in &sender, const uint8_t *data, size_t size, int64_t receive_time);
+
+    void dispatch();
+
+    bool receive_ack(const sockaddr_in &sender, const uint8_t *data, size_t size, int64_t receive_time);
+
+    bool send_to(const sockaddr_in &address, const Datagram &datagram);
+
+    void retransmit();
+
+    void maintain();
+
+    bool enqueue(const uint8_t *data, size_t size, bool reliable, uint64_t key);
+
+    void send_all();
+
+    void set_waiting_to_write(bool waiting);
+
+public:
+    /**
+     * Takes over the given socket, making it non-blocking. Nothing happens on it until start() is called.
+     * @param socket A bound UDP socket
+     * @param sessions The table that HWDs are added to as they connect
+     * @param on_orientation Called on the reactor thread with every batch of well-formed, in-order orientations received
+     * from one session, oldest first.
+     * @param backend How to wait for and receive datagrams. If io_uring isn't available, epoll is used.
+     * @param shard Which of the NetworkShards this reactor is. It only receives from and sends to that shard's sessions.
+     */
+    NetworkReactor(int socket, SessionTable *sessions, OrientationHandler on_orientation,
+                   NetworkBackend backend = NetworkBackend::Epoll, size_t shard = 0);
+
+    /**
+     * Stops the reactor, if it's running.
+     */
+    ~NetworkReactor();
+
+    NetworkReactor(const NetworkReactor &) = delete;
+
+    NetworkReactor &operator=(const NetworkReactor &) = delete;
+
+    /**
+     * Multicasts captions to a group, instead of sending them to each HWD. Must be called before start().
+     * @param group The group's address and port, which the HWDs listen on
+     * @param interface The address of the interface to multicast from, or INADDR_ANY for the default one
+     * @param sender Whether this reactor sends the captions to the group. Otherwise, it only keeps them to send again
+     * to its own sessions; when the port is sharded, one shard sends.
+     * @return Whether the socket could be set up to multicast.
+     */
+    bool multicast_captions(const sockaddr_in &group, in_addr interface, bool sender);
+
+    /**
+     * Starts the reactor's thread.
+     * @param cpu The CPU to pin the thread to, or -1 to let it run anywhere.
+     */
+    void start(int cpu = -1);
+
+    void stop();
+
+    /**
+     * Queues a datagram to be sent to every HWD, and returns without waiting for it to be sent. Safe to call from any
+     * thread.
+     * @return Whether the datagram was queued. It isn't if it's too large or the queue is full.
+     */
+    bool send(const uint8_t *data, size_t size);
+
+    /**
+     * Queues a caption to be sent to every HWD, like send(), and keeps it to be sent again to any HWD that misses it.
+     * @param message_id The caption's message_id, which with its chunk_id identifies it in acknowledgements.
+     */
+    bool send_caption(const uint8_t *data, size_t size, int message_id, int chunk_id);
+
+    /**
+     * @return How many datagrams were dropped because the queue was full, no HWD was connected, or sending failed for
+     * every HWD it was for.
+     */
+    uint64_t dropped_count() const;
+
+    /**
+     * @return The backend in use, which is epoll if io_uring was asked for but isn't available, or has failed.
+     */
+    NetworkBackend network_backend() const;
+
+    /**
+     * @return How many system calls the reactor has made to receive: calls to recvmmsg with epoll, and waits for
+     * completions with io_uring. Only read this once the reactor has stopped.
+     */
+    uint64_t receive_call_count() const;
+
+    /**
+     * @return How many orientations the reactor has accepted. Only read this once the reactor has stopped.
+     */
+    uint64_t received_count() const;
+
+    /**
+     * @return How many datagrams arrived from an HWD whose session belongs to another shard, and were dropped. Only read
+     * this once the reactor has stopped.
+     */
+    uint64_t misrouted_count() const;
+
+    /**
+     * @return How many datagrams the reactor has sent, counting each recipient separately. Only read this once the
+     * reactor has stopped.
+     */
+    uint64_t send_call_count() const;
+
+    /**
+     * @return The captions that can still be sent again. Only read this once the reactor has stopped.
+     */
+    const RetransmitWindow &retransmits() const;
+};
+
+#endif //COG_GROUP_CONVO_CPP_NETWORK_REACTOR_HPP
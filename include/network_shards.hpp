@@ -0,0 +1,65 @@
+#ifndef COG_GROUP_CONVO_CPP_NETWORK_SHARDS_HPP
+#define COG_GROUP_CONVO_CPP_NETWORK_SHARDS_HPP
+
+#include <memory>
+#include <vector>
+#include "network_reactor.hpp"
+#include "session_table.hpp"
+
+/**
+ * One NetworkReactor per socket bound to the server's port. With one socket, this is just a reactor. With several
+ * SO_REUSEPORT sockets, the kernel hashes each HWD's address to one of them, so every datagram from an HWD arrives on
+ * the same shard, and its session (and moving average) is only ever touched by that shard's thread. Each shard's
+ * thread is pinned to its own CPU.
+ * Captions are queued on every shard, and each shard sends them to its own sessions, or the first shard multicasts
+ * them to every HWD at once.
+ */
+class NetworkShards {
+private:
+    std::vector<std::unique_ptr<NetworkReactor>> reactors;
+
+public:
+    /**
+     * @param sockets Bound UDP sockets, one per shard. With more than one, they must share the port with SO_REUSEPORT.
+     * @param sessions The table that HWDs are added to as they connect, shared by the shards
+     * @param on_orientation Called on each shard's thread with batches of orientations from that shard's sessions
+     * @param backend How the shards wait for and receive datagrams
+     */
+    NetworkShards(const std::vector<int> &sockets, SessionTable *sessions,
+                  const NetworkReactor::OrientationHandler &on_orientation, NetworkBackend backend);
+
+    /**
+     * Multicasts captions to a group rather than sending them to each HWD. See NetworkReactor::multicast_captions.
+     */
+    bool multicast_captions(const sockaddr_in &group, in_addr interface);
+
+    void start();
+
+    void stop();
+
+    /**
+     * Queues a datagram on every shard. See NetworkReactor::send.
+     * @return Whether every shard queued it.
+     */
+    bool send(const uint8_t *data, size_t size);
+
+    /**
+     * Queues a caption on every shard. See NetworkReactor::send_caption.
+     * @return Whether every shard queued it.
+     */
+    bool send_caption(const uint8_t *data, size_t size, int message_id, int chunk_id);
+
+    size_t size() const;
+
+    const NetworkReactor &shard(size_t index) const;
+
+    NetworkBackend network_backend() const;
+
+    /**
+     * @return The total of every shard's NetworkReactor::dropped_count. A datagram queued before any HWD connected
+     * counts once per shard.
+     */
+    uint64_t dropped_count() const;
+};
+
+#endif //COG_GROUP_CONVO_CPP_NETWORK_SHARDS_HPP
@@ -1,10 +1,10 @@
 #ifndef COG_GROUP_CONVO_CPP_ORIENTATION_HPP
 #define COG_GROUP_CONVO_CPP_ORIENTATION_HPP
 
-#include <deque>
 #include <netinet/in.h>
-#include <mutex>
 #include "AppContext.hpp"
+#include "orientation_filter.hpp"
+#include "orientation_sample.hpp"
 
 const static int INCHES_FROM_SCREEN = 24; // inches
 constexpr int SCREEN_PIXEL_WIDTH = 3840;
@@ -13,7 +13,6 @@ constexpr double PIXELS_PER_INCH = 100.f /
                                    1.6f; // 100 pixels / 1.6 in (calculated empirically by measuring the width (in inches) of a 100px rectangle, see "ppi" branch)
 //constexpr double PIXELS_PER_INCH = 253.93f;
 constexpr double SCREEN_INCH_WIDTH = (double) SCREEN_PIXEL_WIDTH / PIXELS_PER_INCH;
-constexpr size_t MOVING_AVG_SIZE = 100;
 
 constexpr double PI = 3.14159265358979323846;
 
@@ -23,11 +22,21 @@ int angle_to_pixel_position(double angle);
 
 double to_radians(double degrees);
 
-void read_orientation(int socket, sockaddr_in *client_address, std::mutex *socket_mutex, std::mutex *azimuth_mutex,
-                      std::deque<float> *orientation_buffer);
-
-double filtered_azimuth(std::deque<float> *azimuth_buffer, std::mutex *azimuth_mutex);
-
-double calculate_display_x_from_orientation(const AppContext *app_context);
+/**
+ * Runs a batch of orientations received from the HWD through its filter. The estimate is only published once per
+ * batch.
+ * @param samples The orientations, oldest first
+ */
+void record_orientations(const OrientationSample *samples, size_t count, OrientationFilter *filter);
+
+/**
+ * @return When the frame being composed now is expected to reach the screen, in nanoseconds since the Unix epoch.
+ */
+int64_t presentation_time(const AppContext *app_context);
+
+/**
+ * @param presentation_time When the frame will be on screen, to extrapolate the azimuth to
+ */
+double filtered_azimuth(const OrientationFilter *filter, int64_t presentation_time);
 
 #endif //COG_GROUP_CONVO_CPP_ORIENTATION_HPP
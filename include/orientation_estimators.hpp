@@ -0,0 +1,114 @@
+#ifndef COG_GROUP_CONVO_CPP_ORIENTATION_ESTIMATORS_HPP
+#define COG_GROUP_CONVO_CPP_ORIENTATION_ESTIMATORS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The ways an HWD's azimuth can be smoothed before captions are placed by it.
+ */
+enum class OrientationFilterType {
+    Boxcar, // The circular mean of the last samples. Steady, but lags by half its window, and can't predict.
+    OneEuro, // Smooths harder when the head is still than when it turns.
+    Kalman, // Tracks azimuth and angular velocity, assuming the head turns at a constant rate between samples.
+};
+
+const char *orientation_filter_name(OrientationFilterType type);
+
+/**
+ * Where an estimator thinks the head is pointing, in radians within [-π, π], and how fast it's turning, in radians per
+ * second.
+ */
+struct AzimuthEstimate {
+    float azimuth;
+    float velocity;
+};
+
+/**
+ * @return The angle, wrapped into [-π, π].
+ */
+double wrap_angle(double angle);
+
+/**
+ * The circular mean of the azimuths received in the last WINDOW, kept as a ring with running sums of their sines and
+ * cosines, so that averaging a head turned to either side of ±π doesn't give the azimuth behind it. The window is a
+ * length of time rather than a number of samples, so it smooths as much, and lags as much, however fast the HWD sends.
+ * Expired samples are evicted from the front of the ring as new ones arrive. It never predicts: its velocity is
+ * always 0.
+ */
+class BoxcarEstimator {
+public:
+    constexpr static int64_t WINDOW = 500'000'000; // nanoseconds
+    // Enough for a full window at up to 2 kHz. Beyond that, the oldest samples are evicted before they expire.
+    constexpr static size_t CAPACITY = 1024;
+
+    /**
+     * @param time When the sample was received, in nanoseconds
+     */
+    AzimuthEstimate update(float azimuth, int64_t time);
+
+private:
+    std::array<float, CAPACITY> sines{};
+    std::array<float, CAPACITY> cosines{};
+    std::array<int64_t, CAPACITY> times{};
+    size_t oldest = 0;
+    size_t count = 0;
+    size_t until_refresh = CAPACITY;
+    double sin_sum = 0;
+    double cos_sum = 0;
+
+    void evict_oldest();
+};
+
+/**
+ * The 1€ filter (Casiez et al., CHI 2012): a low-pass filter whose cutoff rises with the speed of the head, so it
+ * removes jitter while the head is still without lagging behind it when it turns. Its velocity is the filtered
+ * derivative it uses to pick the cutoff.
+ */
+class OneEuroEstimator {
+public:
+    constexpr static double MIN_CUTOFF = 0.5; // Hz, the cutoff when the head is still
+    constexpr static double BETA = 10; // Hz for every radian per second the head turns
+    constexpr static double DERIVATIVE_CUTOFF = 1; // Hz
+
+    /**
+     * @param interval Seconds since the previous sample
+     */
+    AzimuthEstimate update(float azimuth, double interval);
+
+    void reset();
+
+private:
+    bool started = false;
+    // The filtered azimuth is kept unwrapped, so that it doesn't jump when the head turns through ±π.
+    double last_raw = 0;
+    double unwrapped = 0;
+    double filtered = 0;
+    double filtered_velocity = 0;
+};
+
+/**
+ * A Kalman filter over azimuth and angular velocity, with the head's angular acceleration treated as white noise.
+ */
+class KalmanEstimator {
+public:
+    constexpr static double ACCELERATION_NOISE = 20; // (rad/s²)² per hertz: how hard we expect the head to turn
+    constexpr static double MEASUREMENT_NOISE = 0.02 * 0.02; // rad², the sensor's variance
+
+    /**
+     * @param interval Seconds since the previous sample
+     */
+    AzimuthEstimate update(float azimuth, double interval);
+
+    void reset();
+
+private:
+    bool started = false;
+    double azimuth = 0;
+    double velocity = 0;
+    // The covariance of (azimuth, velocity).
+    double p00 = 0, p01 = 0, p11 = 0;
+};
+
+#endif //COG_GROUP_CONVO_CPP_ORIENTATION_ESTIMATORS_HPP
@@ -0,0 +1,97 @@
+#ifndef COG_GROUP_CONVO_CPP_ORIENTATION_FILTER_HPP
+#define COG_GROUP_CONVO_CPP_ORIENTATION_FILTER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "orientation_estimators.hpp"
+#include "orientation_sample.hpp"
+
+/**
+ * Smooths an HWD's azimuth with one of the OrientationFilterTypes, and publishes the estimate for the renderer.
+ * One thread pushes samples into it, and any number of threads read the estimate without taking a lock. The estimate
+ * is published behind a sequence number, so readers never see half of one estimate and half of another; a reader
+ * only retries if it overlapped a publish, which happens at most once per batch of samples.
+ */
+class OrientationFilter {
+public:
+    // How long samples have to have been arriving, without a gap, before the estimate is settled.
+    constexpr static int64_t SETTLE_TIME = BoxcarEstimator::WINDOW; // nanoseconds
+    // How far past the newest sample the azimuth is extrapolated, at most. If samples stop arriving, the estimate
+    // holds there, rather than turning forever.
+    constexpr static int64_t MAX_PREDICTION = 100'000'000; // nanoseconds
+    // Samples further apart than this restart the filter, rather than being taken as one fast turn.
+    constexpr static double MAX_INTERVAL = 0.25; // seconds
+
+    struct Snapshot {
+        float azimuth; // radians
+        float velocity; // radians per second
+        int64_t time; // When the newest sample was received, in nanoseconds since the Unix epoch
+        int64_t span; // How long samples have been arriving without a gap, up to the newest, or -1 before the first
+    };
+
+    /**
+     * Picks the filter. Must be called before the first push.
+     */
+    void set_type(OrientationFilterType filter_type);
+
+    OrientationFilterType type() const;
+
+    /**
+     * Runs a batch of samples through the filter, and publishes the new estimate once for the whole batch. Must only
+     * be called from one thread at a time.
+     * @param samples The orientations, oldest first
+     */
+    void push(const OrientationSample *samples, size_t count);
+
+    /**
+     * Forgets every sample, and publishes that there's no estimate, as before the first push. Must only be called
+     * from the thread that pushes.
+     */
+    void reset();
+
+    Snapshot snapshot() const;
+
+    /**
+     * @return The latest estimate, or 0 if there haven't been any samples.
+     */
+    double azimuth() const;
+
+    /**
+     * @param time When the azimuth is wanted, in nanoseconds since the Unix epoch
+     * @return The latest estimate, carried forward to that time at the estimated velocity (for up to MAX_PREDICTION).
+     */
+    double azimuth_at(int64_t time) const;
+
+    /**
+     * @return How long samples have been arriving without a gap, as a fraction of SETTLE_TIME, up to 1. At 1, the
+     * estimate can be trusted.
+     */
+    double settle_progress() const;
+
+private:
+    OrientationFilterType filter_type = OrientationFilterType::Boxcar;
+
+    // Only touched by the writer.
+    BoxcarEstimator boxcar;
+    OneEuroEstimator one_euro;
+    KalmanEstimator kalman;
+    int64_t run_start = 0;
+    bool has_previous = false;
+    OrientationSample previous{};
+
+    // Odd while an estimate is being published.
+    std::atomic<uint32_t> version{0};
+    std::atomic<float> published_azimuth{0};
+    std::atomic<float> published_velocity{0};
+    std::atomic<int64_t> published_time{0};
+    std::atomic<int64_t> published_span{-1};
+
+    /**
+     * @return Seconds between two samples, by the HWD's clock if both have its timestamps, otherwise by when they
+     * arrived.
+     */
+    static double interval_between(const OrientationSample &previous, const OrientationSample &sample);
+};
+
+#endif //COG_GROUP_CONVO_CPP_ORIENTATION_FILTER_HPP
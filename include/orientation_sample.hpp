@@ -0,0 +1,43 @@
+#ifndef COG_GROUP_CONVO_CPP_ORIENTATION_SAMPLE_HPP
+#define COG_GROUP_CONVO_CPP_ORIENTATION_SAMPLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * An orientation received from an HWD, and when it was measured and received.
+ * Times are in nanoseconds since the Unix epoch.
+ */
+struct OrientationSample {
+    float azimuth;
+    bool has_sequence; // Whether the HWD sent a sequence number and timestamp with the orientation
+    uint32_t sequence;
+    int64_t headset_time; // When the HWD measured the orientation, by its clock
+    int64_t receive_time; // When the datagram arrived, by the kernel's clock
+};
+
+/**
+ * An HWD may put this header before the OrientationMessage in a datagram, to number its samples and say when it took
+ * them. Datagrams without it are still accepted, they just can't be checked for loss or reordering. A bare
+ * OrientationMessage can't be mistaken for the header: it starts with the offset of its root table, which is far
+ * smaller than the magic number. The header is in little-endian byte order.
+ */
+struct OrientationHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    int64_t headset_time;
+};
+
+constexpr uint32_t ORIENTATION_HEADER_MAGIC = 0x4F474F43; // "COGO"
+
+/**
+ * Parses and verifies an orientation datagram, with or without an OrientationHeader.
+ * @param data The datagram
+ * @param size The datagram's length
+ * @param receive_time When it was received
+ * @param sample The sample to fill in
+ * @return Whether the datagram held a well-formed OrientationMessage.
+ */
+bool parse_orientation(const uint8_t *data, size_t size, int64_t receive_time, OrientationSample *sample);
+
+#endif //COG_GROUP_CONVO_CPP_ORIENTATION_SAMPLE_HPP
@@ -0,0 +1,89 @@
+#ifndef COG_GROUP_CONVO_CPP_PLAYBACK_CLOCK_HPP
+#define COG_GROUP_CONVO_CPP_PLAYBACK_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vlc/vlc.h>
+
+/**
+ * How closely captions kept to the video: how late each one was sent compared to its deadline, and how far our clock
+ * was from VLC's whenever they were compared.
+ */
+struct SyncStats {
+    uint64_t captions = 0;
+    double total_lateness = 0; // milliseconds
+    double max_lateness = 0;
+    uint64_t drift_samples = 0;
+    double total_absolute_drift = 0; // milliseconds
+    double max_absolute_drift = 0;
+    double last_drift = 0;
+
+    void add_lateness(double lateness);
+
+    void add_drift(double drift);
+};
+
+std::ostream &operator<<(std::ostream &out, const SyncStats &stats);
+
+/**
+ * The time of the video being played, as a steady_clock epoch taken when its first frame is presented. Captions are
+ * scheduled at absolute deadlines against that epoch, so time spent sending them or oversleeping doesn't add up over
+ * a section.
+ * If it's given the media player, the clock is nudged towards VLC's own idea of the playback time every time a
+ * deadline is computed, so that it follows the video if decoding stalls.
+ *
+ * mark_started is called from the render thread; everything else must only be called from the caption thread.
+ */
+class PlaybackClock {
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    // How much of the difference between our clock and VLC's is corrected every time they're compared. VLC's time
+    // only moves once per frame, so correcting all of it at once would make deadlines jitter by a frame.
+    constexpr static double CORRECTION_GAIN = 0.1;
+
+    libvlc_media_player_t *media_player;
+    std::mutex start_mutex;
+    std::condition_variable start_condition;
+    std::atomic<bool> started{false};
+    clock::time_point epoch;
+    SyncStats sync_stats;
+
+    void correct();
+
+public:
+    /**
+     * @param media_player The media player to keep in sync with, or nullptr to rely on the steady clock alone.
+     */
+    explicit PlaybackClock(libvlc_media_player_t *media_player);
+
+    /**
+     * Starts the clock, if it hasn't been started already. Call this when a frame has been presented.
+     */
+    void mark_started();
+
+    /**
+     * Blocks until the first frame of the video has been presented.
+     */
+    void wait_for_start();
+
+    /**
+     * @param media_time A time in the video, in milliseconds since its start
+     * @return When that time will be (or was) on screen.
+     */
+    clock::time_point deadline(double media_time);
+
+    /**
+     * Records how late something scheduled for the given deadline happened, which is now.
+     */
+    void record_lateness(clock::time_point deadline);
+
+    const SyncStats &stats() const;
+};
+
+#endif //COG_GROUP_CONVO_CPP_PLAYBACK_CLOCK_HPP
@@ -5,8 +5,9 @@
 #include <optional>
 #include <SDL2/SDL_ttf.h>
 #include "AppContext.hpp"
+#include "caption_cache.hpp"
+#include "frame_context.hpp"
 
-constexpr int WRAP_LENGTH = 0;
 constexpr int HALF_FOV = 40;
 
 /**
@@ -19,45 +20,35 @@ std::optional<SDL_Rect> rectangle_intersection(const SDL_Rect *a, const SDL_Rect
 
 
 /**
- * Renders the provided surface as a texture on the given renderer, using the position, width, and height provided.
- * @param renderer A pointer to an SDL_Renderer, which the surface will be rendered on
- * @param surface A pointer to the surface to be rendered
- * @param destination_rect The destination rectangle on which to render the surface
- * @param source_rect A rectangle outlining what section of the surface we want to render.
- */
-void render_surface_as_texture(SDL_Renderer *renderer, SDL_Surface *surface, SDL_Rect *source_rect,
-                               SDL_Rect *destination_rect);
-
-/**
- * Renders the given text on the renderer using the position, colors, and font provided.
- * Returns the width and height of the texture rendered.
- * @param renderer A pointer to an SDL_Renderer, to which the text will be rendered
- * @param font A pointer to a TTF_Font, which will be used to display the text.
- * @param text The actual string to be displayed
- * @param x The x location at which to display the string
- * @param y The y location at which to display the string
- * @param foreground_color The color of the text
- * @param background_color The color of the background
+ * Renders the current caption on the renderer in the speaker's font and the colors of the app context, with its
+ * top-left corner at (x, y). The caption is drawn from the caption texture cache, so its text is only rendered again
+ * when it changes.
+ * Returns the width and height of the whole caption.
+ * @param context The app context, whose caption snapshot will be rendered
+ * @param x The x location at which to display the caption
+ * @param y The y location at which to display the caption
+ * @param source_rect The part of the caption to render (relative to its top-left corner), or nullptr for all of it.
  * @return
  */
 std::tuple<int, int>
-render_text(SDL_Renderer *renderer, TTF_Font *font, const std::string &text, int x, int y,
-            const SDL_Color *foreground_color, const SDL_Color *background_color);
+render_caption(const AppContext *context, int x, int y, const SDL_Rect *source_rect);
 
 
-void render_nonregistered_captions(const AppContext *context);
+void render_nonregistered_captions(const AppContext *context, const FrameContext *frame);
 
 /**
  * Renders non-registered captions (captions that remain at a fixed location in the user's field-of-view) using the given app context.
  * @param context
+ * @param frame The pose and geometry of the frame being composed
  */
-void render_nonregistered_captions_with_indicators(const AppContext *context);
+void render_nonregistered_captions_with_indicators(const AppContext *context, const FrameContext *frame);
 
 /**
  * Renders registered captions (which remain fixed in space, pinned to the body of the person speaking)
  * using the given app context.
  * @param context
+ * @param frame The pose and geometry of the frame being composed
  */
-void render_registered_captions(const AppContext *context);
+void render_registered_captions(const AppContext *context, const FrameContext *frame);
 
 #endif //COG_GROUP_CONVO_CPP_PRESENTATION_METHODS_HPP
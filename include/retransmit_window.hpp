@@ -0,0 +1,117 @@
+#ifndef COG_GROUP_CONVO_CPP_RETRANSMIT_WINDOW_HPP
+#define COG_GROUP_CONVO_CPP_RETRANSMIT_WINDOW_HPP
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "session_table.hpp"
+
+/**
+ * Sent by an HWD to acknowledge the captions it has received. A caption is identified by its message_id and chunk_id,
+ * which order captions within a section. The HWD acknowledges the last caption up to which it has received every
+ * caption (or message_id -1 if it hasn't received any), followed by nack_count CaptionIds of captions after that
+ * which it knows it's missing. Everything is in little-endian byte order.
+ */
+struct CaptionAck {
+    uint32_t magic;
+    int32_t message_id;
+    int32_t chunk_id;
+    uint32_t nack_count;
+};
+
+struct CaptionId {
+    int32_t message_id;
+    int32_t chunk_id;
+};
+
+constexpr uint32_t CAPTION_ACK_MAGIC = 0x41474F43; // "COGA"
+
+/**
+ * @return A key that orders captions by message, then by chunk.
+ */
+uint64_t caption_key(int32_t message_id, int32_t chunk_id);
+
+/**
+ * The last CAPACITY captions sent, kept so they can be sent again to any HWD that didn't get them.
+ * HWDs that have never sent a CaptionAck are assumed not to support them, and are never sent anything twice.
+ * For the others, a caption is sent again when it's negatively acknowledged, or when it hasn't been acknowledged
+ * TIMEOUT after it was last sent. Retransmits are paced to at most RETRANSMITS_PER_TICK every TICK, so a burst of
+ * losses can't flood the link that's losing them. Captions older than the window are given up on.
+ * Not thread-safe: it belongs to the network reactor.
+ */
+class RetransmitWindow {
+public:
+    using clock = std::chrono::steady_clock;
+
+    constexpr static size_t CAPACITY = 64;
+    constexpr static size_t MAX_DATAGRAM_SIZE = 1024;
+    constexpr static auto TIMEOUT = std::chrono::milliseconds(150);
+    constexpr static auto TICK = std::chrono::milliseconds(10);
+    constexpr static size_t RETRANSMITS_PER_TICK = 8;
+
+    /**
+     * Sends a datagram to a recipient.
+     * @return false if the socket can't take any more right now.
+     */
+    using Sender = std::function<bool(size_t recipient, const uint8_t *data, size_t size)>;
+
+private:
+    using Recipients = std::bitset<SessionTable::MAX_SESSIONS>;
+
+    struct Slot {
+        uint64_t key;
+        size_t size;
+        std::array<uint8_t, MAX_DATAGRAM_SIZE> data;
+        Recipients unacknowledged;
+        Recipients negatively_acknowledged;
+        std::array<clock::time_point, SessionTable::MAX_SESSIONS> last_sent;
+    };
+
+    std::array<Slot, CAPACITY> slots;
+    size_t head = 0;
+    size_t count = 0;
+    // The recipients that have ever acknowledged a caption.
+    Recipients acknowledging;
+    uint64_t retransmit_count = 0;
+    uint64_t abandoned_count = 0;
+
+    Slot &at(size_t age_from_oldest);
+
+public:
+    /**
+     * Records a caption that was just sent to recipients [0, recipients).
+     */
+    void sent(uint64_t key, const uint8_t *data, size_t size, size_t recipients, clock::time_point now);
+
+    /**
+     * Handles a CaptionAck (and the CaptionIds after it) from a recipient.
+     */
+    void acknowledge(size_t recipient, const CaptionAck &ack, const CaptionId *nacks);
+
+    /**
+     * Stops tracking a recipient, whose slot may go to someone else, which starts out not acknowledging anything.
+     */
+    void forget(size_t recipient);
+
+    /**
+     * Sends whatever is due to be sent again, within this tick's budget.
+     */
+    void retransmit(clock::time_point now, const Sender &send);
+
+    /**
+     * @return Whether any caption is still waiting to be acknowledged by someone.
+     */
+    bool has_unacknowledged() const;
+
+    uint64_t retransmits() const;
+
+    /**
+     * @return How many (caption, recipient) pairs were evicted from the window before being acknowledged.
+     */
+    uint64_t abandoned() const;
+};
+
+#endif //COG_GROUP_CONVO_CPP_RETRANSMIT_WINDOW_HPP
@@ -0,0 +1,155 @@
+#ifndef COG_GROUP_CONVO_CPP_SESSION_TABLE_HPP
+#define COG_GROUP_CONVO_CPP_SESSION_TABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <netinet/in.h>
+#include "orientation_filter.hpp"
+#include "orientation_sample.hpp"
+
+/**
+ * How well an HWD's orientations are getting through. Loss and reordering can only be counted for HWDs that number
+ * their samples, and delay only for those that timestamp them.
+ */
+struct LinkStats {
+    // How much of each new delay goes into the rolling averages.
+    constexpr static double SMOOTHING = 1.0 / 16;
+
+    uint64_t received = 0;
+    uint64_t lost = 0; // Skipped sequence numbers that never arrived (as far as we know)
+    uint64_t out_of_order = 0; // Samples that arrived after a newer one, and were dropped
+    uint64_t resyncs = 0; // Times the sequence numbers started over, as when the HWD restarts
+    uint64_t delay_samples = 0;
+    double mean_delay = 0; // milliseconds from the HWD's timestamp to the kernel receiving the datagram
+    double min_delay = 0;
+    double mean_jitter = 0; // mean absolute change in delay between consecutive samples
+    double last_delay = 0;
+
+    void add_delay(double delay);
+};
+
+std::ostream &operator<<(std::ostream &out, const LinkStats &stats);
+
+/**
+ * One HWD connected to the server, identified by the address it sends its orientation from. Each session smooths
+ * its own orientation, so HWDs don't disturb each other's captions.
+ */
+struct Session {
+    // A jump in sequence numbers further than this, either way, is taken as the HWD having restarted.
+    constexpr static int64_t RESYNC_JUMP = 1024;
+    // As is a silence longer than this.
+    constexpr static int64_t RESYNC_GAP = 1'000'000'000; // nanoseconds
+    // How far back a late sample can still be matched with the gap it left, so that it isn't counted as lost.
+    constexpr static int64_t LATE_WINDOW = 64;
+
+    sockaddr_in address{};
+    // The network shard whose thread receives from this HWD, and sends to it.
+    size_t shard = 0;
+    OrientationFilter orientation;
+    // The address as one number, so that shards can find the session without a lock, or 0 while the slot is free.
+    std::atomic<uint64_t> endpoint{0};
+    // When the HWD last sent anything, in nanoseconds since the Unix epoch.
+    std::atomic<int64_t> last_heard{0};
+
+    // Only touched by the network reactor of the session's shard.
+    LinkStats link_stats;
+    bool has_sequence = false;
+    uint32_t last_sequence = 0;
+    int64_t last_receive_time = 0;
+    // Bit n is set if last_sequence - n was skipped, and counted as lost.
+    uint64_t missing = 0;
+
+    /**
+     * @return Whether an HWD has the session. Its address and shard can only be read once this has returned true.
+     */
+    bool active() const;
+
+    /**
+     * Accounts for a sample from this HWD, and decides whether it should be used. A skipped sequence number is counted
+     * as lost until it turns up, when it's counted as out of order instead. After a jump or a silence that means the
+     * HWD restarted, counting starts over from its new sequence numbers.
+     * Must only be called from the network reactor.
+     * @return false if the sample is older than one already received, so it should be dropped.
+     */
+    bool accept(const OrientationSample &sample);
+
+    /**
+     * Forgets everything about the last HWD to have the session, before another takes it.
+     */
+    void reset();
+};
+
+/**
+ * The HWDs that are connected, up to MAX_SESSIONS of them. They live in a fixed array, so that pointers to them stay
+ * valid for the life of the table. An HWD that hasn't sent anything for IDLE_TIMEOUT is disconnected, and its slot
+ * is given to the next HWD to connect; an HWD that reconnects from a new port gets a new session.
+ * The display follows the primary session's orientation. That's the first HWD to connect, until it has been quiet for
+ * PRIMARY_QUIET_TIME, at which point the display moves to whichever HWD was heard from most recently. The primary
+ * session exists before anyone connects, so that the display can be pointed at it up front.
+ * find_or_add and expire_idle may be called from each network shard's thread, as long as an address only ever arrives
+ * on one shard. Sessions can be read from any thread.
+ */
+class SessionTable {
+public:
+    constexpr static size_t MAX_SESSIONS = 32;
+    constexpr static int64_t IDLE_TIMEOUT = 5'000'000'000; // nanoseconds
+    constexpr static int64_t PRIMARY_QUIET_TIME = 1'000'000'000; // nanoseconds
+
+    /**
+     * Called on the shard's thread with the index of each of its sessions that timed out.
+     */
+    using ExpiredHandler = std::function<void(size_t index)>;
+
+private:
+    std::array<Session, MAX_SESSIONS> sessions;
+    // How many slots have ever been used. Slots past this have never had an HWD.
+    std::atomic<size_t> count{0};
+    std::atomic<Session *> primary_session{&sessions[0]};
+    // Serializes shards adding and removing sessions, and moving the primary session. Finding one doesn't need it.
+    std::mutex add_mutex;
+
+    bool is_quiet(const Session &session, int64_t now) const;
+
+public:
+    /**
+     * @param filter How every session smooths its HWD's orientation
+     */
+    explicit SessionTable(OrientationFilterType filter = OrientationFilterType::Boxcar);
+
+    /**
+     * @param address Where a datagram came from
+     * @param shard The shard the datagram arrived on, which the session belongs to if it's new
+     * @param now When the datagram arrived, in nanoseconds since the Unix epoch
+     * @return The session of the HWD at that address, which is created if it's new, or nullptr if it's new and the
+     * table is full.
+     */
+    Session *find_or_add(const sockaddr_in &address, size_t shard, int64_t now);
+
+    /**
+     * Disconnects the shard's HWDs that haven't been heard from for IDLE_TIMEOUT, and moves the primary session on if
+     * it has gone quiet.
+     * @param now The time, in nanoseconds since the Unix epoch
+     */
+    void expire_idle(size_t shard, int64_t now, const ExpiredHandler &on_expired);
+
+    Session *primary();
+
+    /**
+     * @return The number of slots that have been used. Only sessions in [0, size()) can be active.
+     */
+    size_t size() const;
+
+    /**
+     * @return How many HWDs are connected.
+     */
+    size_t active_count() const;
+
+    Session &at(size_t index);
+
+    size_t index_of(const Session *session) const;
+};
+
+#endif //COG_GROUP_CONVO_CPP_SESSION_TABLE_HPP
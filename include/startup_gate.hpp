@@ -0,0 +1,58 @@
+#ifndef COG_GROUP_CONVO_CPP_STARTUP_GATE_HPP
+#define COG_GROUP_CONVO_CPP_STARTUP_GATE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+/**
+ * Holds playback back until the primary HWD's orientation has settled, without the main thread spinning on it.
+ * The network thread reports how close to ready it is as samples arrive, but only wakes the main thread when that
+ * moves on by a whole step (a tenth of the way), so reporting costs an atomic load for almost every batch.
+ * report must only be called from one thread; everything else may be called from any.
+ */
+class StartupGate {
+public:
+    enum class Outcome {
+        Ready,
+        TimedOut,
+        Cancelled,
+    };
+
+    constexpr static int PROGRESS_STEPS = 10;
+
+    /**
+     * @param progress How close to ready, from 0 to 1. The gate opens at 1.
+     */
+    void report(double progress);
+
+    /**
+     * Makes wait return Cancelled, if the gate hasn't opened already.
+     */
+    void cancel();
+
+    bool is_open() const;
+
+    /**
+     * Sleeps until the gate opens, it's cancelled, or the timeout passes.
+     * @param poll_interval How often to call on_progress if nothing changes, so the caller can look at its own events
+     * @param on_progress Called with the progress so far whenever it changes, and every poll_interval. Returns false
+     * to cancel.
+     */
+    Outcome wait(std::chrono::steady_clock::duration timeout, std::chrono::steady_clock::duration poll_interval,
+                 const std::function<bool(double progress)> &on_progress);
+
+private:
+    std::atomic<bool> open{false};
+    // Only touched by the reporting thread.
+    int reported_step = -1;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    double progress = 0;
+    bool cancelled = false;
+};
+
+#endif //COG_GROUP_CONVO_CPP_STARTUP_GATE_HPP
@@ -0,0 +1,45 @@
+#ifndef COG_GROUP_CONVO_CPP_TEXT_LAYOUT_HPP
+#define COG_GROUP_CONVO_CPP_TEXT_LAYOUT_HPP
+
+#include <array>
+#include <string>
+#include <SDL2/SDL_ttf.h>
+
+/**
+ * The advance widths of a font's printable ASCII glyphs, measured once when the font is opened.
+ * This lets captions be broken into lines by their real pixel width without asking SDL_ttf to measure text on
+ * every word (or every frame). Characters outside of printable ASCII are measured as '?'.
+ */
+class GlyphMetrics {
+private:
+    constexpr static int FIRST_GLYPH = ' ';
+    constexpr static int LAST_GLYPH = '~';
+
+    TTF_Font *font;
+    std::array<int, LAST_GLYPH - FIRST_GLYPH + 1> advances{};
+    int line_skip;
+
+public:
+    explicit GlyphMetrics(TTF_Font *font);
+
+    /**
+     * @param c A character
+     * @return How far (in pixels) the pen moves after drawing c.
+     */
+    int advance(char c) const;
+
+    /**
+     * @param text A single line of text
+     * @return The width of the text in pixels, when drawn in this font.
+     */
+    int measure(const std::string &text) const;
+
+    /**
+     * @return The distance (in pixels) between the tops of two consecutive lines in this font.
+     */
+    int line_height() const;
+
+    TTF_Font *get_font() const;
+};
+
+#endif //COG_GROUP_CONVO_CPP_TEXT_LAYOUT_HPP
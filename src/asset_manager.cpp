@@ -0,0 +1,47 @@
+#include <iostream>
+#include <SDL_image.h>
+#include "asset_manager.hpp"
+
+static SDL_Texture *upload(SDL_Renderer *renderer, SDL_Surface *surface) {
+    auto texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (!texture) {
+        std::cerr << "Couldn't create texture from image: " << SDL_GetError() << std::endl;
+    }
+    return texture;
+}
+
+AssetManager::AssetManager(SDL_Renderer *renderer) : renderer(renderer) {}
+
+AssetManager::~AssetManager() {
+    for (auto &[path, entry]: entries) {
+        SDL_DestroyTexture(entry.asset.texture);
+        SDL_FreeSurface(entry.surface);
+    }
+}
+
+const Asset *AssetManager::load(const std::string &path) {
+    auto existing = entries.find(path);
+    if (existing != entries.end()) {
+        return &existing->second.asset;
+    }
+    auto surface = IMG_Load(path.c_str());
+    if (!surface) {
+        std::cerr << "IMG_Load: " << IMG_GetError() << std::endl;
+        return nullptr;
+    }
+    auto texture = upload(renderer, surface);
+    if (!texture) {
+        SDL_FreeSurface(surface);
+        return nullptr;
+    }
+    auto &entry = entries[path];
+    entry = Entry{surface, Asset{texture, surface->w, surface->h}};
+    return &entry.asset;
+}
+
+void AssetManager::reload() {
+    for (auto &[path, entry]: entries) {
+        SDL_DestroyTexture(entry.asset.texture);
+        entry.asset.texture = upload(renderer, entry.surface);
+    }
+}
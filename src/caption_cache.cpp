@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <iostream>
+#include "caption_cache.hpp"
+
+static bool same_color(const SDL_Color &a, const SDL_Color &b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+bool CaptionTextureKey::operator==(const CaptionTextureKey &other) const {
+    return generation == other.generation && font == other.font &&
+           same_color(foreground_color, other.foreground_color) &&
+           same_color(background_color, other.background_color) && wrap_width == other.wrap_width;
+}
+
+CaptionTextureCache::CaptionTextureCache(size_t capacity) : capacity(capacity) {
+    entries.reserve(capacity);
+}
+
+CaptionTextureCache::~CaptionTextureCache() {
+    clear();
+}
+
+SDL_Texture *CaptionTextureCache::create_texture(SDL_Renderer *renderer, int width, int height) {
+    // Text drawn with SDL_BLENDMODE_BLEND onto a transparent texture comes out premultiplied by its alpha, so it has to
+    // be drawn onto the frame without being multiplied again.
+    static const auto premultiplied = SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+    auto texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!texture) {
+        std::cerr << "Couldn't create caption texture: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    if (SDL_SetTextureBlendMode(texture, premultiplied) < 0) {
+        std::cerr << "The renderer can't draw premultiplied textures, captions won't be cached: " << SDL_GetError()
+                  << std::endl;
+        SDL_DestroyTexture(texture);
+        usable = false;
+        return nullptr;
+    }
+    return texture;
+}
+
+SDL_Texture *CaptionTextureCache::get(SDL_Renderer *renderer, GlyphAtlas *atlas, const CaptionTextureKey &key,
+                                      const CaptionSnapshot *snapshot) {
+    if (!usable) {
+        return nullptr;
+    }
+    ++clock;
+    // There are only ever a handful of entries, so a linear scan beats hashing the key.
+    for (auto &entry: entries) {
+        if (entry.key == key) {
+            entry.last_used = clock;
+            ++hit_count;
+            return entry.texture;
+        }
+    }
+    ++miss_count;
+
+    const auto width = std::max(key.wrap_width, snapshot->width);
+    const auto height = snapshot->height;
+    Entry *entry = nullptr;
+    if (entries.size() == capacity) {
+        auto least_recently_used = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->width == width && it->height == height && (!entry || it->last_used < entry->last_used)) {
+                entry = &*it;
+            }
+            if (it->last_used < least_recently_used->last_used) {
+                least_recently_used = it;
+            }
+        }
+        if (entry) {
+            ++reuse_count;
+        } else {
+            SDL_DestroyTexture(least_recently_used->texture);
+            entries.erase(least_recently_used);
+        }
+    }
+    if (!entry) {
+        auto texture = create_texture(renderer, width, height);
+        if (!texture) {
+            return nullptr;
+        }
+        entries.push_back(Entry{key, texture, width, height, clock});
+        entry = &entries.back();
+    }
+    entry->key = key;
+    entry->last_used = clock;
+
+    // Render the caption into the texture, then put the renderer back the way we found it. Clearing also wipes
+    // whatever caption the texture held before.
+    auto previous_target = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, entry->texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    atlas->render_text(renderer, snapshot->text, 0, 0, &key.foreground_color, &key.background_color);
+    SDL_SetRenderTarget(renderer, previous_target);
+    return entry->texture;
+}
+
+void CaptionTextureCache::clear() {
+    for (auto &entry: entries) {
+        SDL_DestroyTexture(entry.texture);
+    }
+    entries.clear();
+}
+
+uint64_t CaptionTextureCache::hits() const {
+    return hit_count;
+}
+
+uint64_t CaptionTextureCache::misses() const {
+    return miss_count;
+}
+
+uint64_t CaptionTextureCache::reuses() const {
+    return reuse_count;
+}
@@ -0,0 +1,268 @@
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "caption_track.hpp"
+#include "nlohmann/json.hpp"
+
+CaptionTrack::CaptionTrack(void *mapping, size_t mapping_size) : mapping(mapping), mapping_size(mapping_size) {
+    const auto header = static_cast<const CaptionTrackHeader *>(mapping);
+    event_count = header->event_count;
+    events = reinterpret_cast<const CaptionEvent *>(static_cast<const char *>(mapping) + sizeof(CaptionTrackHeader));
+    text_pool = reinterpret_cast<const char *>(events + event_count);
+}
+
+CaptionTrack::~CaptionTrack() {
+    munmap(mapping, mapping_size);
+}
+
+std::unique_ptr<CaptionTrack> CaptionTrack::open(const std::string &path) {
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Couldn't open caption track " << path << ": " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) < 0 || file_stat.st_size < static_cast<off_t>(sizeof(CaptionTrackHeader))) {
+        std::cerr << "Caption track " << path << " is too small to be one." << std::endl;
+        close(fd);
+        return nullptr;
+    }
+    const auto size = static_cast<size_t>(file_stat.st_size);
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive on its own.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Couldn't map caption track " << path << ": " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+
+    // Check everything that playback would otherwise have to check for every event.
+    const auto header = static_cast<const CaptionTrackHeader *>(mapping);
+    if (header->magic != CaptionTrack::MAGIC || header->version != CaptionTrack::VERSION ||
+        sizeof(CaptionTrackHeader) + header->event_count * sizeof(CaptionEvent) + header->text_pool_size != size) {
+        std::cerr << "Caption track " << path << " wasn't compiled by this version, or is truncated." << std::endl;
+        munmap(mapping, size);
+        return nullptr;
+    }
+    std::unique_ptr<CaptionTrack> track(new CaptionTrack(mapping, size));
+    for (const auto &event: *track) {
+        if (static_cast<size_t>(event.text_offset) + event.text_length >= header->text_pool_size ||
+            track->text_pool[event.text_offset + event.text_length] != '\0' ||
+            event.speaker < cog::Juror_MIN || event.speaker > cog::Juror_MAX) {
+            std::cerr << "Caption track " << path << " is malformed." << std::endl;
+            return nullptr;
+        }
+    }
+    return track;
+}
+
+const CaptionEvent *CaptionTrack::begin() const {
+    return events;
+}
+
+const CaptionEvent *CaptionTrack::end() const {
+    return events + event_count;
+}
+
+size_t CaptionTrack::size() const {
+    return event_count;
+}
+
+std::string_view CaptionTrack::text(const CaptionEvent &event) const {
+    return {text_pool + event.text_offset, event.text_length};
+}
+
+cog::Juror CaptionTrack::speaker(const CaptionEvent &event) const {
+    return static_cast<cog::Juror>(event.speaker);
+}
+
+/**
+ * @return Whether juror_str names a juror, which is then stored in juror.
+ */
+static bool parse_juror(const std::string &juror_str, cog::Juror *juror) {
+    if (juror_str == "juror-a") {
+        *juror = cog::Juror_JurorA;
+    } else if (juror_str == "juror-b") {
+        *juror = cog::Juror_JurorB;
+    } else if (juror_str == "juror-c") {
+        *juror = cog::Juror_JurorC;
+    } else if (juror_str == "jury-foreman") {
+        *juror = cog::Juror_JuryForeman;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Builds the events and text pool of a track straight from the tokens of the JSON, as they're read.
+ * Nothing but the track itself is kept, so memory grows with the track rather than with the size of a DOM.
+ * A handler that finds something wrong records why in `error`, and stops the parse by returning false.
+ */
+class CaptionTrackSax : public nlohmann::json_sax<nlohmann::json> {
+private:
+    // Which of a caption's fields have been seen, so that incomplete captions are caught.
+    enum Field {
+        TEXT = 1, TIME = 2, MESSAGE_ID = 4, CHUNK_ID = 8, SPEAKER = 16, ALL_FIELDS = 31
+    };
+
+    // Only read for the position of errors.
+    std::istream *caption_json;
+    int depth = 0;
+    std::string current_key;
+    CaptionEvent event{};
+    int fields = 0;
+
+    bool set_number(double value) {
+        if (depth != 2) {
+            return true;
+        }
+        if (current_key == "delay") {
+            event.time = value;
+            fields |= TIME;
+        } else if (current_key == "message_id") {
+            event.message_id = static_cast<int32_t>(value);
+            fields |= MESSAGE_ID;
+        } else if (current_key == "chunk_id") {
+            event.chunk_id = static_cast<int32_t>(value);
+            fields |= CHUNK_ID;
+        }
+        return true;
+    }
+
+public:
+    std::vector<CaptionEvent> events;
+    std::string text_pool;
+    std::string error;
+
+    explicit CaptionTrackSax(std::istream *caption_json) : caption_json(caption_json) {}
+
+    bool null() override {
+        return true;
+    }
+
+    bool boolean(bool) override {
+        return true;
+    }
+
+    bool number_integer(number_integer_t value) override {
+        return set_number(static_cast<double>(value));
+    }
+
+    bool number_unsigned(number_unsigned_t value) override {
+        return set_number(static_cast<double>(value));
+    }
+
+    bool number_float(number_float_t value, const string_t &) override {
+        return set_number(value);
+    }
+
+    bool string(string_t &value) override {
+        if (depth != 2) {
+            return true;
+        }
+        if (current_key == "text") {
+            event.text_offset = text_pool.size();
+            event.text_length = value.size();
+            text_pool.append(value).append(1, '\0');
+            fields |= TEXT;
+        } else if (current_key == "speaker_id") {
+            cog::Juror speaker;
+            if (!parse_juror(value, &speaker)) {
+                error = "Unknown speaker ID \"" + value + "\" in caption " + std::to_string(events.size());
+                // The parser has read up to the end of the string, so the stream is just after it, if it can tell.
+                const auto position = static_cast<std::streamoff>(caption_json->tellg());
+                if (position >= 0) {
+                    error += ", ending at byte " + std::to_string(position);
+                }
+                return false;
+            }
+            event.speaker = speaker;
+            fields |= SPEAKER;
+        }
+        return true;
+    }
+
+    bool binary(binary_t &) override {
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        ++depth;
+        if (depth == 2) {
+            event = CaptionEvent{};
+            fields = 0;
+        }
+        return true;
+    }
+
+    bool key(string_t &value) override {
+        current_key.swap(value);
+        return true;
+    }
+
+    bool end_object() override {
+        if (depth == 2) {
+            if (fields != ALL_FIELDS) {
+                error = "Caption " + std::to_string(events.size()) + " is missing one of text, delay, message_id, "
+                        "chunk_id or speaker_id.";
+                return false;
+            }
+            events.push_back(event);
+        }
+        --depth;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        ++depth;
+        return true;
+    }
+
+    bool end_array() override {
+        --depth;
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &ex) override {
+        error = "Couldn't parse captions at byte " + std::to_string(position) + ": " + ex.what();
+        return false;
+    }
+};
+
+bool compile_caption_track(std::istream &caption_json, const std::string &path) {
+    CaptionTrackSax sax(&caption_json);
+    if (!nlohmann::json::sax_parse(caption_json, &sax)) {
+        std::cerr << sax.error << std::endl;
+        return false;
+    }
+
+    CaptionTrackHeader header{CaptionTrack::MAGIC, CaptionTrack::VERSION, static_cast<uint32_t>(sax.events.size()),
+                              static_cast<uint32_t>(sax.text_pool.size())};
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(sax.events.data()),
+               static_cast<std::streamsize>(sax.events.size() * sizeof(CaptionEvent)));
+    file.write(sax.text_pool.data(), static_cast<std::streamsize>(sax.text_pool.size()));
+    if (!file) {
+        std::cerr << "Couldn't write caption track " << path << std::endl;
+        return false;
+    }
+    std::cout << "Compiled " << sax.events.size() << " captions into " << path << std::endl;
+    return true;
+}
+
+cog::Juror juror_from_string(const std::string &juror_str) {
+    cog::Juror juror;
+    if (!parse_juror(juror_str, &juror)) {
+        throw std::invalid_argument("Unknown speaker ID encountered: " + juror_str);
+    }
+    return juror;
+}
@@ -0,0 +1,13 @@
+#include "caption_transmitter.hpp"
+
+CaptionTransmitter::CaptionTransmitter(NetworkShards *network) : network(network) {}
+
+bool CaptionTransmitter::transmit(const std::string &text, cog::Juror speaker_id, cog::Juror focused_id,
+                                  int message_id, int chunk_id) {
+    // Clearing keeps the builder's buffer, so this only allocates if this word needs more room than any before it.
+    builder.Clear();
+    auto caption_message = cog::CreateCaptionMessageDirect(builder, text.c_str(), speaker_id, focused_id, message_id,
+                                                           chunk_id);
+    builder.Finish(caption_message);
+    return network->send_caption(builder.GetBufferPointer(), builder.GetSize(), message_id, chunk_id);
+}
@@ -2,110 +2,92 @@
 #include <iostream>
 #include "captions.hpp"
 
-std::string CaptionModel::wrap(const std::string &text, const int line_length) {
-    std::istringstream words(text);
-    std::vector<std::string> wrapped_lines;
-    std::string word;
+CaptionModel::CaptionModel(const std::map<cog::Juror, const GlyphMetrics *> *juror_metrics) : juror_metrics(
+        juror_metrics) {}
 
-    if (words >> word) {
-        wrapped_lines.emplace_back(word);
-        size_t space_left = line_length - word.length();
-        while (words >> word) {
-            if (space_left < word.length() + 1) {
-                wrapped_lines.emplace_back(word);
-                space_left = line_length - word.length();
-            } else {
-                wrapped_lines.back() += ' ' + word;
-                space_left -= word.length() + 1;
-            }
-        }
-    }
-    if (wrapped_lines.empty()) {
-        return "";
-    }
-    if (wrapped_lines.size() == 1) {
-        return wrapped_lines.back();
+void CaptionModel::append_to_lines(const std::string &new_word, const GlyphMetrics *metrics) {
+    const int word_width = metrics->measure(new_word);
+    const int space_width = metrics->advance(' ');
+    if (current_line.empty()) {
+        current_line = new_word;
+        current_line_width = word_width;
+    } else if (current_line_width + space_width + word_width > LINE_WIDTH) {
+        // Only the last two lines are ever displayed, so the oldest one can be dropped.
+        previous_line.swap(current_line);
+        previous_line_width = current_line_width;
+        current_line = new_word;
+        current_line_width = word_width;
+    } else {
+        current_line += ' ';
+        current_line += new_word;
+        current_line_width += space_width + word_width;
     }
-    return wrapped_lines.at(wrapped_lines.size() - 2) + '\n' + wrapped_lines.at(wrapped_lines.size() - 1);
 }
 
-void CaptionModel::add_word(const std::string &new_word, cog::Juror speaker) {
-    text_mutex.lock();
-    if (!spoken_so_far.empty() && spoken_so_far.back().first != speaker) {
-        spoken_so_far.clear();
+void CaptionModel::publish(cog::Juror speaker, const GlyphMetrics *metrics) {
+    auto &next = snapshots[back];
+    next.juror = speaker;
+    if (previous_line.empty()) {
+        next.text = current_line;
+        next.width = current_line_width;
+        next.height = metrics->line_height();
+    } else {
+        next.text.assign(previous_line).append(1, '\n').append(current_line);
+        next.width = std::max(previous_line_width, current_line_width);
+        next.height = 2 * metrics->line_height();
     }
-    spoken_so_far.emplace_back(speaker, new_word);
-    text_mutex.unlock();
+    next.generation = ++generation;
+    // Hand the filled slot to the reader, and take whichever slot it isn't using for the next word.
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
 }
 
-std::pair<cog::Juror, std::string> CaptionModel::get_current_text(const int line_length) {
-    std::string current_speech;
-    cog::Juror current_juror = cog::Juror_JuryForeman;
-    text_mutex.lock();
-    if (!spoken_so_far.empty()) {
-        current_juror = spoken_so_far.front().first;
-        for (const auto&[_, word]: spoken_so_far) {
-            current_speech += word + " ";
-        }
+void CaptionModel::add_word(const std::string &new_word, cog::Juror speaker) {
+    if (current_speaker && *current_speaker != speaker) {
+        previous_line.clear();
+        current_line.clear();
+        previous_line_width = 0;
+        current_line_width = 0;
     }
-    text_mutex.unlock();
-    return std::make_pair(current_juror, wrap(current_speech, line_length));
+    const auto metrics = juror_metrics->at(speaker);
+    current_speaker = speaker;
+    append_to_lines(new_word, metrics);
+    publish(speaker, metrics);
 }
 
-cog::Juror juror_from_string(const std::string &juror_str) {
-    cog::Juror juror;
-    if (juror_str == "juror-a") {
-        juror = cog::Juror_JurorA;
-    } else if (juror_str == "juror-b") {
-        juror = cog::Juror_JurorB;
-    } else if (juror_str == "juror-c") {
-        juror = cog::Juror_JurorC;
-    } else if (juror_str == "jury-foreman") {
-        juror = cog::Juror_JuryForeman;
-    } else {
-        std::cerr << "Unknown speaker ID encountered: " << juror_str << std::endl;
-        throw;
+void CaptionModel::get_current_text(CaptionSnapshot *current) {
+    if (middle.load(std::memory_order_relaxed) & FRESH) {
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
     }
-    return juror;
-}
-
-void transmit_caption(int socket, sockaddr_in* client_address, std::mutex *socket_mutex, const std::string &text,
-                      cog::Juror speaker_id, cog::Juror focused_id, int message_id, int chunk_id) {
-    flatbuffers::FlatBufferBuilder builder(1024);
-    auto caption_message = cog::CreateCaptionMessageDirect(builder, text.c_str(), speaker_id, focused_id, message_id,
-                                                           chunk_id);
-    builder.Finish(caption_message);
-    uint8_t *buffer = builder.GetBufferPointer();
-    const auto size = builder.GetSize();
-    socklen_t len = sizeof(*client_address);
-
-    socket_mutex->lock();
-    if (sendto(socket, buffer, 1024, 0, (struct sockaddr *) &(*client_address),
-               len) < 0) {
-        std::cerr << "sendto failed: " << strerror(errno) << std::endl;
+    const auto &latest = snapshots[front];
+    if (current->generation != latest.generation) {
+        current->juror = latest.juror;
+        current->width = latest.width;
+        current->height = latest.height;
+        // Assigning into the caller's string reuses its capacity, so this only allocates while the text is growing.
+        current->text.assign(latest.text);
+        current->generation = latest.generation;
     }
-    socket_mutex->unlock();
 }
 
-
 void
-start_caption_stream(int socket, sockaddr_in* client_address, std::mutex *socket_mutex, nlohmann::json *caption_json,
-                     CaptionModel *model) {
-    for (auto i = 0; i < caption_json->size(); ++i) {
-        auto text = caption_json->at(i)["text"].get<std::string>();
-        double delay;
-        if (i == 0) {
-            delay = caption_json->at(i)["delay"].get<double>();
-        } else {
-            delay = caption_json->at(i)["delay"].get<double>() - caption_json->at(i - 1)["delay"].get<double>();
-        }
-        auto speaker_id_str = caption_json->at(i)["speaker_id"].get<std::string>();
-        auto speaker_id = juror_from_string(speaker_id_str);
-        auto message_id = caption_json->at(i)["message_id"].get<int>();
-        auto chunk_id = caption_json->at(i)["chunk_id"].get<int>();
+start_caption_stream(NetworkShards *network, const CaptionTrack *track, CaptionModel *model,
+                     PlaybackClock *playback_clock) {
+    // Reused for every word, so that copying the text out of the track doesn't allocate once it's long enough.
+    std::string text;
+    CaptionTransmitter transmitter(network);
+    // Caption times are relative to the start of the video, so wait for it to actually be on screen.
+    playback_clock->wait_for_start();
+    for (const auto &event: *track) {
+        text.assign(track->text(event));
+        const auto speaker_id = track->speaker(event);
         auto focused_id = cog::Juror_JuryForeman;
-        std::this_thread::sleep_for(std::chrono::duration<double, std::ratio<1, 1000>>(delay));
-        transmit_caption(socket, client_address, socket_mutex, text, speaker_id, focused_id, message_id, chunk_id);
+        // Sleep until the word's absolute deadline, rather than for the gap since the last word, so that time spent
+        // sending or oversleeping doesn't push every later caption back.
+        const auto deadline = playback_clock->deadline(event.time);
+        std::this_thread::sleep_until(deadline);
+        playback_clock->record_lateness(deadline);
+        transmitter.transmit(text, speaker_id, focused_id, event.message_id, event.chunk_id);
         model->add_word(text, speaker_id);
     }
+    std::cout << "Caption sync: " << playback_clock->stats() << std::endl;
 }
@@ -8,10 +8,11 @@
 
 /**
  * Prints a QR code to the console. The QR code's contents are formatted as follows:
- * "<MACHINE_IP_ADDR>:<PORT> <PRESENTATION_METHOD>"
+ * "<MACHINE_IP_ADDR>:<PORT> <PRESENTATION_METHOD>", followed by " <GROUP_ADDR>:<GROUP_PORT>" if captions are multicast.
  * @param presentation_method
+ * @param multicast_group Where captions are multicast, or empty if they aren't
  */
-void print_connection_qr(int presentation_method, int port) {
+void print_connection_qr(int presentation_method, int port, const std::string &multicast_group) {
     struct ifaddrs *ifap, *ifa;
     struct sockaddr_in *sa;
     char *addr;
@@ -27,7 +28,11 @@ void print_connection_qr(int presentation_method, int port) {
 
                 std::string address = std::string(addr);
                 std::string address_port = address + ":" + std::to_string(port);
-                command << "qrencode -t ANSI \"" << addr << ":" << port << " " << presentation_method << "\"";
+                command << "qrencode -t ANSI \"" << addr << ":" << port << " " << presentation_method;
+                if (!multicast_group.empty()) {
+                    command << " " << multicast_group;
+                }
+                command << "\"";
                 std::cout << "Command is: " << command.str() << std::endl;
                 system(command.str().c_str());
                 break;
@@ -66,6 +71,36 @@ std::tuple<int, sockaddr_in> connect_to_client(int port) {
     return std::make_tuple(sockfd, cliaddr);
 }
 
+std::vector<int> connect_to_clients(int port, size_t count) {
+    if (count == 1) {
+        return {std::get<0>(connect_to_client(port))};
+    }
+    struct sockaddr_in servaddr{};
+    servaddr.sin_family = AF_INET; // IPv4
+    servaddr.sin_addr.s_addr = INADDR_ANY;
+    servaddr.sin_port = htons(port);
+    std::vector<int> sockets;
+    for (size_t i = 0; i < count; ++i) {
+        int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sockfd < 0) {
+            std::cerr << "socket() failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        // Every socket binds the same port, and the kernel spreads HWDs across them by their address.
+        const int enable = 1;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+            perror("SO_REUSEPORT failed");
+            exit(EXIT_FAILURE);
+        }
+        if (bind(sockfd, (const struct sockaddr *) &servaddr, sizeof(servaddr)) < 0) {
+            perror("bind failed");
+            exit(EXIT_FAILURE);
+        }
+        sockets.push_back(sockfd);
+    }
+    return sockets;
+}
+
 SDL_Color color_string_to_color(const std::string &color_str) {
     SDL_Color result{0, 0, 0, 0};
     std::stringstream s_stream(color_str); //create string stream from the string
@@ -81,7 +116,23 @@ SDL_Color color_string_to_color(const std::string &color_str) {
     return result;
 }
 
-std::tuple<int, int, SDL_Color, SDL_Color, std::string, int>
+bool address_from_string(const std::string &address_str, sockaddr_in *address) {
+    const auto colon = address_str.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    *address = sockaddr_in{};
+    address->sin_family = AF_INET;
+    try {
+        address->sin_port = htons(std::stoi(address_str.substr(colon + 1)));
+    } catch (const std::exception &) {
+        return false;
+    }
+    return inet_pton(AF_INET, address_str.substr(0, colon).c_str(), &address->sin_addr) == 1;
+}
+
+std::tuple<int, int, SDL_Color, SDL_Color, std::string, int, NetworkBackend, int, std::string, std::string,
+        OrientationFilterType>
 parse_arguments(int argc, char *argv[]) {
     int video_section;
     int presentation_method;
@@ -89,11 +140,18 @@ parse_arguments(int argc, char *argv[]) {
     SDL_Color background_color{0, 0, 0, 0};
     std::string path_to_font;
     int font_size;
+    auto network_backend = NetworkBackend::Epoll;
+    std::string network_backend_str;
+    int receive_threads = 1;
+    std::string multicast_group;
+    std::string multicast_interface;
+    auto orientation_filter = OrientationFilterType::Boxcar;
+    std::string orientation_filter_str;
     int cmd_opt;
     int option_index = 0;
     std::string fg_color_str;
     std::string bg_color_str;
-    cmd_opt = getopt_long(argc, argv, "v:m:f:b:p:s:", long_options, &option_index);
+    cmd_opt = getopt_long(argc, argv, "v:m:f:b:p:s:n:r:g:i:o:", long_options, &option_index);
     while (cmd_opt) {
         if (cmd_opt == -1) {
             break;
@@ -123,12 +181,50 @@ parse_arguments(int argc, char *argv[]) {
             case 's':
                 font_size = std::stoi(optarg);
                 break;
+            case 'n':
+                network_backend_str = std::string(optarg);
+                if (network_backend_str == "epoll") {
+                    network_backend = NetworkBackend::Epoll;
+                } else if (network_backend_str == "io_uring") {
+                    network_backend = NetworkBackend::IoUring;
+                } else {
+                    std::cerr << "Please pick a network backend, epoll or io_uring." << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'r':
+                receive_threads = std::stoi(optarg);
+                if (receive_threads <= 0) {
+                    std::cerr << "Please use at least one receive thread." << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'g':
+                multicast_group = std::string(optarg);
+                break;
+            case 'i':
+                multicast_interface = std::string(optarg);
+                break;
+            case 'o':
+                orientation_filter_str = std::string(optarg);
+                if (orientation_filter_str == "boxcar") {
+                    orientation_filter = OrientationFilterType::Boxcar;
+                } else if (orientation_filter_str == "one_euro") {
+                    orientation_filter = OrientationFilterType::OneEuro;
+                } else if (orientation_filter_str == "kalman") {
+                    orientation_filter = OrientationFilterType::Kalman;
+                } else {
+                    std::cerr << "Please pick an orientation filter, boxcar, one_euro or kalman." << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case '?':
             default:
                 std::cerr << "Unknown option received: " << cmd_opt << std::endl;
         }
-        cmd_opt = getopt_long(argc, argv, "v:m:f:b:p:s:", long_options, &option_index);
+        cmd_opt = getopt_long(argc, argv, "v:m:f:b:p:s:n:r:g:i:o:", long_options, &option_index);
     }
     return std::make_tuple(video_section, presentation_method, foreground_color, background_color, path_to_font,
-                           font_size);
+                           font_size, network_backend, receive_threads, multicast_group, multicast_interface,
+                           orientation_filter);
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "frame_context.hpp"
+#include "orientation.hpp"
+#include "presentation_methods.hpp"
+
+FrameContext capture_frame_context(const AppContext *context) {
+    // Half of the FOV is the same number of pixels every frame.
+    static const auto half_fov_width = angle_to_pixel_position(to_radians(HALF_FOV));
+
+    FrameContext frame{};
+    frame.azimuth = filtered_azimuth(&context->sessions->primary()->orientation, presentation_time(context));
+    frame.azimuth_x = angle_to_pixel_position(frame.azimuth);
+    frame.fov_region = SDL_Rect{frame.azimuth_x - half_fov_width, 0, 2 * half_fov_width, context->window_height};
+
+    // Caption positions under the jurors are kept as fractions of the VLC surface, so they're re-hydrated with its
+    // current size.
+    const auto snapshot = context->caption_snapshot;
+    const auto position = context->juror_positions->find(snapshot->juror);
+    if (position != context->juror_positions->end()) {
+        const auto[left_x_percent, left_y_percent] = position->second;
+        frame.caption_rect = SDL_Rect{static_cast<int>(left_x_percent * context->display_rect.w),
+                                      static_cast<int>(left_y_percent * context->display_rect.h),
+                                      snapshot->width, snapshot->height};
+    }
+    return frame;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <iostream>
+#include "glyph_atlas.hpp"
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer *renderer, const GlyphMetrics *metrics) : metrics(metrics) {
+    const SDL_Color white{0xFF, 0xFF, 0xFF, 0xFF};
+    std::array<SDL_Surface *, LAST_GLYPH - FIRST_GLYPH + 1> glyph_surfaces{};
+
+    // Rasterize every glyph, and shelf-pack them left to right into rows of ATLAS_WIDTH pixels.
+    // The solid block goes first, at the top-left corner.
+    solid_rect = SDL_Rect{0, 0, SOLID_BLOCK_SIZE, SOLID_BLOCK_SIZE};
+    int pen_x = SOLID_BLOCK_SIZE + 1;
+    int row_y = 0;
+    int row_height = SOLID_BLOCK_SIZE;
+    for (auto c = FIRST_GLYPH; c <= LAST_GLYPH; ++c) {
+        auto glyph_surface = TTF_RenderGlyph_Blended(metrics->get_font(), c, white);
+        if (!glyph_surface) {
+            std::cerr << "TTF_RenderGlyph_Blended failed for '" << static_cast<char>(c) << "': " << TTF_GetError()
+                      << std::endl;
+            continue;
+        }
+        if (pen_x + glyph_surface->w > ATLAS_WIDTH) {
+            pen_x = 0;
+            row_y += row_height + 1;
+            row_height = 0;
+        }
+        glyph_rects[c - FIRST_GLYPH] = SDL_Rect{pen_x, row_y, glyph_surface->w, glyph_surface->h};
+        glyph_surfaces[c - FIRST_GLYPH] = glyph_surface;
+        pen_x += glyph_surface->w + 1;
+        row_height = std::max(row_height, glyph_surface->h);
+    }
+    texture_width = ATLAS_WIDTH;
+    texture_height = row_y + row_height;
+
+    surface = SDL_CreateRGBSurfaceWithFormat(0, texture_width, texture_height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        std::cerr << "Couldn't create glyph atlas surface: " << SDL_GetError() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    SDL_FillRect(surface, &solid_rect, SDL_MapRGBA(surface->format, 0xFF, 0xFF, 0xFF, 0xFF));
+    for (auto i = 0; i < static_cast<int>(glyph_surfaces.size()); ++i) {
+        if (!glyph_surfaces[i]) {
+            continue;
+        }
+        // Copy the glyph's alpha as-is instead of blending it onto the (transparent) atlas.
+        SDL_SetSurfaceBlendMode(glyph_surfaces[i], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(glyph_surfaces[i], nullptr, surface, &glyph_rects[i]);
+        SDL_FreeSurface(glyph_surfaces[i]);
+    }
+    upload(renderer);
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    SDL_DestroyTexture(texture);
+    SDL_FreeSurface(surface);
+}
+
+void GlyphAtlas::upload(SDL_Renderer *renderer) {
+    texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (!texture) {
+        std::cerr << "Couldn't create glyph atlas texture: " << SDL_GetError() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+}
+
+void GlyphAtlas::reload(SDL_Renderer *renderer) {
+    SDL_DestroyTexture(texture);
+    upload(renderer);
+}
+
+const SDL_Rect &GlyphAtlas::glyph_rect(char c) const {
+    if (c < FIRST_GLYPH || c > LAST_GLYPH) {
+        c = '?';
+    }
+    return glyph_rects[c - FIRST_GLYPH];
+}
+
+void GlyphAtlas::add_quad(const SDL_Rect &destination, const SDL_Rect &source, const SDL_Color &color) {
+    const auto first_vertex = static_cast<int>(vertices.size());
+    const auto left = static_cast<float>(destination.x);
+    const auto top = static_cast<float>(destination.y);
+    const auto right = static_cast<float>(destination.x + destination.w);
+    const auto bottom = static_cast<float>(destination.y + destination.h);
+    const auto u0 = static_cast<float>(source.x) / texture_width;
+    const auto v0 = static_cast<float>(source.y) / texture_height;
+    const auto u1 = static_cast<float>(source.x + source.w) / texture_width;
+    const auto v1 = static_cast<float>(source.y + source.h) / texture_height;
+    vertices.push_back(SDL_Vertex{{left, top}, color, {u0, v0}});
+    vertices.push_back(SDL_Vertex{{right, top}, color, {u1, v0}});
+    vertices.push_back(SDL_Vertex{{right, bottom}, color, {u1, v1}});
+    vertices.push_back(SDL_Vertex{{left, bottom}, color, {u0, v1}});
+    for (const auto corner: {0, 1, 2, 0, 2, 3}) {
+        indices.push_back(first_vertex + corner);
+    }
+}
+
+std::tuple<int, int>
+GlyphAtlas::render_text(SDL_Renderer *renderer, const std::string &text, int x, int y,
+                        const SDL_Color *foreground_color, const SDL_Color *background_color) {
+    vertices.clear();
+    indices.clear();
+    // The background quad has to be drawn first (so it's underneath the glyphs), but its size is only known once
+    // the glyphs are laid out. Reserve its slot now and fill it in afterwards.
+    add_quad(SDL_Rect{x, y, 0, 0}, solid_rect, *background_color);
+
+    const auto line_height = metrics->line_height();
+    int width = 0;
+    int pen_x = x;
+    int pen_y = y;
+    for (const auto c: text) {
+        if (c == '\n') {
+            width = std::max(width, pen_x - x);
+            pen_x = x;
+            pen_y += line_height;
+            continue;
+        }
+        const auto &source = glyph_rect(c);
+        if (c != ' ' && source.w > 0) {
+            add_quad(SDL_Rect{pen_x, pen_y, source.w, source.h}, source, *foreground_color);
+        }
+        pen_x += metrics->advance(c);
+    }
+    width = std::max(width, pen_x - x);
+    const int height = pen_y + line_height - y;
+
+    // Sample the background from the middle of the solid block, and stretch it over the whole box.
+    const auto solid_u = (solid_rect.x + solid_rect.w / 2.f) / texture_width;
+    const auto solid_v = (solid_rect.y + solid_rect.h / 2.f) / texture_height;
+    const SDL_FPoint corners[] = {
+            {static_cast<float>(x),         static_cast<float>(y)},
+            {static_cast<float>(x + width), static_cast<float>(y)},
+            {static_cast<float>(x + width), static_cast<float>(y + height)},
+            {static_cast<float>(x),         static_cast<float>(y + height)}
+    };
+    for (auto i = 0; i < 4; ++i) {
+        vertices[i].position = corners[i];
+        vertices[i].tex_coord = SDL_FPoint{solid_u, solid_v};
+    }
+
+    SDL_RenderGeometry(renderer, texture, vertices.data(), static_cast<int>(vertices.size()), indices.data(),
+                       static_cast<int>(indices.size()));
+    return std::make_tuple(width, height);
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "io_uring_ring.hpp"
+
+#ifdef HAVE_IO_URING_MULTISHOT
+
+// The kernel and this process share the rings' heads and tails, so they're read and written with the same ordering
+// liburing uses: a tail is published with release semantics, and the other side's index is read with acquire.
+template<typename T>
+static T load_acquire(const T *value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+static void store_release(T *value, T new_value) {
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+// How long to back off when the kernel can't take submissions yet.
+static const timespec RETRY_PAUSE{0, 1'000'000};
+
+static int io_uring_setup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg,
+                          size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, void *arg, unsigned arg_count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, arg_count));
+}
+
+std::unique_ptr<IoUringRing> IoUringRing::create(unsigned entries, unsigned buffer_count, size_t buffer_size) {
+    io_uring_params params{};
+    // By default, the completion queue is only twice the size of the submission queue, but every buffer can be holding
+    // a completion, and the wakeups and polls need room besides.
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = std::max(2 * entries, 2 * buffer_count);
+    std::unique_ptr<IoUringRing> ring(new IoUringRing());
+    ring->ring_fd = io_uring_setup(entries, &params);
+    if (ring->ring_fd < 0) {
+        std::cerr << "io_uring_setup failed: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    // Waiting with a timeout needs IORING_FEAT_EXT_ARG (Linux 5.11).
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        std::cerr << "io_uring can't wait with a timeout on this kernel." << std::endl;
+        return nullptr;
+    }
+    if (!ring->map_rings(params)) {
+        return nullptr;
+    }
+    if (!ring->supports_multishot_receive()) {
+        std::cerr << "io_uring can't receive in multishot on this kernel." << std::endl;
+        return nullptr;
+    }
+    if (!ring->register_buffers(buffer_count, buffer_size)) {
+        return nullptr;
+    }
+    return ring;
+}
+
+bool IoUringRing::map_rings(const io_uring_params &params) {
+    submission_mapping_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    completion_mapping_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const auto single_mapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mapping) {
+        submission_mapping_size = completion_mapping_size = std::max(submission_mapping_size, completion_mapping_size);
+    }
+    submission_mapping = mmap(nullptr, submission_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ring_fd, IORING_OFF_SQ_RING);
+    if (submission_mapping == MAP_FAILED) {
+        submission_mapping = nullptr;
+        std::cerr << "Couldn't map the io_uring submission queue: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (single_mapping) {
+        completion_mapping = submission_mapping;
+    } else {
+        completion_mapping = mmap(nullptr, completion_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring_fd, IORING_OFF_CQ_RING);
+        if (completion_mapping == MAP_FAILED) {
+            completion_mapping = nullptr;
+            std::cerr << "Couldn't map the io_uring completion queue: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    submission_entries_size = params.sq_entries * sizeof(io_uring_sqe);
+    auto entries = mmap(nullptr, submission_entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                        IORING_OFF_SQES);
+    if (entries == MAP_FAILED) {
+        std::cerr << "Couldn't map the io_uring submissions: " << strerror(errno) << std::endl;
+        return false;
+    }
+    submission_entries = static_cast<io_uring_sqe *>(entries);
+
+    auto submission_base = static_cast<uint8_t *>(submission_mapping);
+    submission_head = reinterpret_cast<unsigned *>(submission_base + params.sq_off.head);
+    submission_tail = reinterpret_cast<unsigned *>(submission_base + params.sq_off.tail);
+    submission_mask = *reinterpret_cast<unsigned *>(submission_base + params.sq_off.ring_mask);
+    submission_array = reinterpret_cast<unsigned *>(submission_base + params.sq_off.array);
+    auto completion_base = static_cast<uint8_t *>(completion_mapping);
+    completion_head = reinterpret_cast<unsigned *>(completion_base + params.cq_off.head);
+    completion_tail = reinterpret_cast<unsigned *>(completion_base + params.cq_off.tail);
+    completion_mask = *reinterpret_cast<unsigned *>(completion_base + params.cq_off.ring_mask);
+    completion_entries = reinterpret_cast<io_uring_cqe *>(completion_base + params.cq_off.cqes);
+    return true;
+}
+
+bool IoUringRing::supports_multishot_receive() const {
+    // Multishot recvmsg came in Linux 6.0, which has no feature flag for it. IORING_OP_SEND_ZC came in the same
+    // release, so it stands in.
+    constexpr size_t PROBE_OPS = 256;
+    const auto probe_size = sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op);
+    std::unique_ptr<uint8_t[]> probe_memory(new uint8_t[probe_size]());
+    auto probe = reinterpret_cast<io_uring_probe *>(probe_memory.get());
+    if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+        return false;
+    }
+    return probe->last_op >= IORING_OP_SEND_ZC && (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+}
+
+bool IoUringRing::register_buffers(unsigned count, size_t size) {
+    buffer_count = count;
+    buffer_size = size;
+    buffer_ring_size = count * sizeof(io_uring_buf);
+    auto ring = mmap(nullptr, buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        std::cerr << "Couldn't allocate the io_uring buffer ring: " << strerror(errno) << std::endl;
+        return false;
+    }
+    buffer_ring = static_cast<io_uring_buf_ring *>(ring);
+    auto memory = mmap(nullptr, count * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Couldn't allocate the io_uring buffers: " << strerror(errno) << std::endl;
+        return false;
+    }
+    buffers = static_cast<uint8_t *>(memory);
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(buffer_ring);
+    registration.ring_entries = count;
+    registration.bgid = BUFFER_GROUP;
+    if (io_uring_register(ring_fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        std::cerr << "Couldn't register the io_uring buffer ring: " << strerror(errno) << std::endl;
+        return false;
+    }
+    for (unsigned id = 0; id < count; ++id) {
+        recycle(id);
+    }
+    return true;
+}
+
+IoUringRing::~IoUringRing() {
+    if (ring_fd >= 0) {
+        close(ring_fd);
+    }
+    if (buffers) {
+        munmap(buffers, buffer_count * buffer_size);
+    }
+    if (buffer_ring) {
+        munmap(buffer_ring, buffer_ring_size);
+    }
+    if (submission_entries) {
+        munmap(submission_entries, submission_entries_size);
+    }
+    if (completion_mapping && completion_mapping != submission_mapping) {
+        munmap(completion_mapping, completion_mapping_size);
+    }
+    if (submission_mapping) {
+        munmap(submission_mapping, submission_mapping_size);
+    }
+}
+
+io_uring_sqe *IoUringRing::submission() {
+    if (*submission_tail + 1 - load_acquire(submission_head) > submission_mask + 1) {
+        enter(0, nullptr);
+    }
+    const auto tail = *submission_tail;
+    const auto index = tail & submission_mask;
+    auto entry = &submission_entries[index];
+    std::memset(entry, 0, sizeof(*entry));
+    submission_array[index] = index;
+    store_release(submission_tail, tail + 1);
+    ++pending;
+    return entry;
+}
+
+bool IoUringRing::wait(const timespec *timeout) {
+    return enter(1, timeout);
+}
+
+bool IoUringRing::enter(unsigned min_complete, const timespec *timeout) {
+    __kernel_timespec kernel_timeout{};
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeout) {
+        kernel_timeout.tv_sec = timeout->tv_sec;
+        kernel_timeout.tv_nsec = timeout->tv_nsec;
+        arg.ts = reinterpret_cast<uint64_t>(&kernel_timeout);
+    }
+    const auto flags = (min_complete ? IORING_ENTER_GETEVENTS : 0) | IORING_ENTER_EXT_ARG;
+    const auto submitted = io_uring_enter(ring_fd, pending, min_complete, flags, &arg, sizeof(arg));
+    if (submitted < 0) {
+        if (errno == ETIME || errno == EINTR) {
+            return true;
+        }
+        if (errno == EAGAIN || errno == EBUSY) {
+            // The kernel is short of memory for requests, or the completion queue is full. Nothing is lost: what's
+            // pending is submitted again next time, once the caller has consumed the completions. If there are none
+            // to consume, give the kernel a moment rather than spinning.
+            if (*completion_head == load_acquire(completion_tail)) {
+                nanosleep(&RETRY_PAUSE, nullptr);
+            }
+            return true;
+        }
+        std::cerr << "io_uring_enter failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    pending -= submitted;
+    return true;
+}
+
+const io_uring_cqe *IoUringRing::completion() {
+    const auto head = *completion_head;
+    if (head == load_acquire(completion_tail)) {
+        return nullptr;
+    }
+    return &completion_entries[head & completion_mask];
+}
+
+void IoUringRing::consume() {
+    store_release(completion_head, *completion_head + 1);
+}
+
+uint8_t *IoUringRing::buffer(uint16_t id) {
+    return buffers + id * buffer_size;
+}
+
+void IoUringRing::recycle(uint16_t id) {
+    // Not buffer_ring->bufs: compiled as C++, the kernel header's empty struct in front of the flexible array takes up
+    // space, which moves the entries. They start at the start of the ring, with the tail overlaid on the first one.
+    auto &entry = reinterpret_cast<io_uring_buf *>(buffer_ring)[buffer_tail & (buffer_count - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+    entry.len = buffer_size;
+    entry.bid = id;
+    ++buffer_tail;
+    store_release(&buffer_ring->tail, buffer_tail);
+}
+
+#else
+
+std::unique_ptr<IoUringRing> IoUringRing::create(unsigned, unsigned, size_t) {
+    std::cerr << "This was built without io_uring: the kernel headers are older than Linux 6.0." << std::endl;
+    return nullptr;
+}
+
+// There's never a ring to call these on.
+IoUringRing::~IoUringRing() = default;
+
+io_uring_sqe *IoUringRing::submission() {
+    return nullptr;
+}
+
+bool IoUringRing::wait(const timespec *) {
+    return false;
+}
+
+const io_uring_cqe *IoUringRing::completion() {
+    return nullptr;
+}
+
+void IoUringRing::consume() {}
+
+uint8_t *IoUringRing::buffer(uint16_t) {
+    return nullptr;
+}
+
+void IoUringRing::recycle(uint16_t) {}
+
+#endif
@@ -2,12 +2,18 @@
 #include <iostream>
 #include "experiment_setup.hpp"
 #include "presentation_methods.hpp"
-#include "nlohmann/json.hpp"
 #include "captions.hpp"
 #include "orientation.hpp"
+#include "asset_manager.hpp"
+#include "network_shards.hpp"
+#include "session_table.hpp"
+#include "startup_gate.hpp"
 #include <thread>
 #include <fstream>
 #include <cstdlib>
+#include <memory>
+#include <chrono>
+#include <ctime>
 #include <vlc/vlc.h>
 
 #include <SDL2/SDL.h>
@@ -21,6 +27,16 @@
 #define FONT_SIZE_MEDIUM 26
 #define FONT_SIZE_LARGE 28
 
+#define CAPTION_CACHE_CAPACITY 4
+
+// How long to wait for the HWD's orientation to settle before giving up, and how often to check for the window being
+// closed meanwhile.
+#define STARTUP_TIMEOUT_SECONDS 300
+#define STARTUP_POLL_MS 100
+
+// Whether caption deadlines follow VLC's playback time, or only the steady clock from the first frame.
+#define SYNC_CAPTIONS_TO_VLC true
+
 #define WINDOW_TITLE "Four Angry Men"
 
 #define REGISTERED_GRAPHICS 1
@@ -61,18 +77,23 @@ static void unlock(void *data, [[maybe_unused]] void *id, [[maybe_unused]] void
 
     const auto *app_context = (AppContext *) data;
 
+    // Pick up any words that arrived since the last frame. If none did, this is just a generation comparison.
+    app_context->caption_model->get_current_text(app_context->caption_snapshot);
+    // Take the head's pose once for the whole frame, so that everything drawn in it agrees.
+    const auto frame = capture_frame_context(app_context);
+
     // Based on the presentation method selected by the researcher, we want to render captions in different ways.
     switch (app_context->presentation_method) {
         case REGISTERED_GRAPHICS:
             // Registered graphics remain stationary in space
-            render_registered_captions(app_context);
+            render_registered_captions(app_context, &frame);
             break;
         case NONREGISTERED_GRAPHICS:
             // Non-registered graphics follow the user's head orientation around the screen
-            render_nonregistered_captions(app_context);
+            render_nonregistered_captions(app_context, &frame);
             break;
         case NONREGISTERED_GRAPHICS_WITH_ARROWS:
-            render_nonregistered_captions_with_indicators(app_context);
+            render_nonregistered_captions_with_indicators(app_context, &frame);
             break;
         case CONTROL:
             break;
@@ -81,6 +102,8 @@ static void unlock(void *data, [[maybe_unused]] void *id, [[maybe_unused]] void
             break;
     }
     SDL_RenderPresent(app_context->renderer);
+    // Captions are timed from the first frame that makes it to the screen.
+    app_context->playback_clock->mark_started();
     SDL_UnlockTexture(app_context->texture);
     SDL_UnlockMutex(app_context->mutex);
 }
@@ -113,7 +136,12 @@ int main(int argc, char *argv[]) {
     foreground_color, // What color will the text be? RGBA format
     background_color, // What color will the background behind the text be? RGBA format
     path_to_font, // Where's the smallest_font located?
-    font_size // How big will the smallest_font be?
+    font_size, // How big will the smallest_font be?
+    network_backend, // How will the server wait for and receive datagrams?
+    receive_threads, // How many threads will receive from the HWDs?
+    multicast_group, // Where will captions be multicast to, if anywhere? "<ADDR>:<PORT>"
+    multicast_interface, // Which interface will they be multicast from?
+    orientation_filter // How will each HWD's orientation be smoothed?
     ] = parse_arguments(argc, argv);
 
     std::cout << "Using presentation method: " << presentation_method << std::endl;
@@ -121,9 +149,9 @@ int main(int argc, char *argv[]) {
 
     // Print the address of this server, and which presentation method we're going to be using.
     // This QR code will be scanned by the HWD so that it can connect to our server.
-    print_connection_qr(presentation_method, PORT);
-    // Now, wait for the connection.
-    auto[socket, cliaddr] = connect_to_client(PORT);
+    print_connection_qr(presentation_method, PORT, multicast_group);
+    // Now, bind the sockets the HWDs will connect to: one per receive thread, all on the same port.
+    auto sockets = connect_to_clients(PORT, receive_threads);
 
     // Let's start building our application context. This is basically a struct that stores pointers to
     // important mutexes, buffers, and variables.
@@ -171,6 +199,19 @@ int main(int argc, char *argv[]) {
             {cog::Juror_JurorC,      medium_font}
     };
     app_context.juror_font_sizes = &juror_font_sizes;
+    // Measure each font's glyphs once, so captions can be broken into lines by pixel width without re-measuring.
+    const GlyphMetrics smallest_font_metrics(smallest_font);
+    const GlyphMetrics medium_font_metrics(medium_font);
+    const GlyphMetrics largest_font_metrics(largest_font);
+    const std::map<TTF_Font *, const GlyphMetrics *> font_metrics{
+            {smallest_font, &smallest_font_metrics},
+            {medium_font,   &medium_font_metrics},
+            {largest_font,  &largest_font_metrics}
+    };
+    std::map<cog::Juror, const GlyphMetrics *> juror_metrics;
+    for (const auto &[juror, font]: juror_font_sizes) {
+        juror_metrics[juror] = font_metrics.at(font);
+    }
 
 
     // Lastly, let's initialize SDL_image, which will load images for us.
@@ -213,22 +254,43 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Couldn't create texture: %s\n", SDL_GetError());
     }
     app_context.mutex = SDL_CreateMutex();
-
-    // Load the two indicator images that we'll use to point towards the next speaker.
-    std::string back_arrow_path = "resources/images/arrow_back.png";
-    std::string forward_arrow_path = "resources/images/arrow_forward.png";
-    SDL_Surface *back_arrow = IMG_Load(back_arrow_path.c_str());
-    if (!back_arrow) {
-        printf("IMG_Load: %s\n", IMG_GetError());
-        exit(EXIT_FAILURE);
+    // With vsync, a frame composed now goes up at the next refresh, so registered captions are placed where the head
+    // will be then.
+    SDL_DisplayMode display_mode;
+    const auto refresh_rate = SDL_GetWindowDisplayMode(window, &display_mode) == 0 && display_mode.refresh_rate > 0
+                              ? display_mode.refresh_rate : 60;
+    app_context.presentation_delay = 1'000'000'000 / refresh_rate;
+
+    // Rasterize each font's glyphs once, so that drawing captions every frame is just a batch of textured quads.
+    // Their textures belong to the renderer, so they're released before it's destroyed (see the end of main).
+    auto smallest_font_atlas = std::make_unique<GlyphAtlas>(app_context.renderer, &smallest_font_metrics);
+    auto medium_font_atlas = std::make_unique<GlyphAtlas>(app_context.renderer, &medium_font_metrics);
+    auto largest_font_atlas = std::make_unique<GlyphAtlas>(app_context.renderer, &largest_font_metrics);
+    const std::map<TTF_Font *, GlyphAtlas *> font_atlases{
+            {smallest_font, smallest_font_atlas.get()},
+            {medium_font,   medium_font_atlas.get()},
+            {largest_font,  largest_font_atlas.get()}
+    };
+    app_context.font_atlases = &font_atlases;
+
+    // Keep rendered captions as textures between words. This needs render targets; without them, captions are drawn
+    // straight from the glyph atlases every frame.
+    std::unique_ptr<CaptionTextureCache> caption_cache;
+    if (SDL_RenderTargetSupported(app_context.renderer)) {
+        caption_cache = std::make_unique<CaptionTextureCache>(CAPTION_CACHE_CAPACITY);
+    } else {
+        std::cerr << "Render targets aren't supported, captions won't be cached." << std::endl;
     }
-    SDL_Surface *forward_arrow = IMG_Load(forward_arrow_path.c_str());
-    if (!forward_arrow) {
-        printf("IMG_Load: %s\n", IMG_GetError());
+    app_context.caption_cache = caption_cache.get();
+
+    // Load the two indicator images that we'll use to point towards the next speaker. They're uploaded to the
+    // renderer once here, and drawn from their textures every frame.
+    auto assets = std::make_unique<AssetManager>(app_context.renderer);
+    app_context.back_arrow = assets->load("resources/images/arrow_back.png");
+    app_context.forward_arrow = assets->load("resources/images/arrow_forward.png");
+    if (!app_context.back_arrow || !app_context.forward_arrow) {
         exit(EXIT_FAILURE);
     }
-    app_context.back_arrow = back_arrow;
-    app_context.forward_arrow = forward_arrow;
 
     // Now that we've configured our app context, let's get ready to boot up VLC.
     libvlc_instance_t *libvlc;
@@ -260,32 +322,108 @@ int main(int argc, char *argv[]) {
     libvlc_video_set_callbacks(mp, lock, unlock, display, &app_context);
     libvlc_video_set_format(mp, "RV16", app_context.window_width, app_context.window_height,
                             app_context.window_width * 2);
+    PlaybackClock playback_clock(SYNC_CAPTIONS_TO_VLC ? mp : nullptr);
+    app_context.playback_clock = &playback_clock;
+
+    // Every HWD that connects gets a session, with its own moving average of its orientation. The display follows
+    // the primary session, which is the first HWD to connect, or the latest one to be heard from once it goes quiet.
+    SessionTable sessions(orientation_filter);
+    app_context.sessions = &sessions;
+    // Playback waits for the primary HWD's orientation to settle. Its shard reports how far along that is.
+    StartupGate startup_gate;
+    // All of a socket's I/O happens on its shard's thread: orientations from each HWD go into its session's filter,
+    // and captions are sent to every HWD.
+    NetworkShards network(sockets, &sessions, [&startup_gate, &sessions](
+            Session *session, const OrientationSample *samples, size_t count) {
+        record_orientations(samples, count, &session->orientation);
+        if (session == sessions.primary() && !startup_gate.is_open()) {
+            startup_gate.report(session->orientation.settle_progress());
+        }
+    }, network_backend);
+    std::cout << "Network backend: " << (network.network_backend() == NetworkBackend::IoUring ? "io_uring" : "epoll")
+              << ", " << network.size() << " receive threads" << std::endl;
+    std::cout << "Orientation filter: " << orientation_filter_name(orientation_filter) << std::endl;
+    // Optionally, send each caption once to a multicast group, instead of once to every HWD.
+    if (!multicast_group.empty()) {
+        sockaddr_in group{};
+        sockaddr_in interface{};
+        interface.sin_addr.s_addr = INADDR_ANY;
+        if (!address_from_string(multicast_group, &group) || !IN_MULTICAST(ntohl(group.sin_addr.s_addr)) ||
+            (!multicast_interface.empty() && !address_from_string(multicast_interface + ":0", &interface))) {
+            std::cerr << "Please give a multicast group as <ADDR>:<PORT>, and an interface as <ADDR>." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (!network.multicast_captions(group, interface.sin_addr)) {
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "Multicasting captions to " << multicast_group << std::endl;
+    }
+    network.start();
+    const auto network_start = std::chrono::steady_clock::now();
 
-    std::mutex azimuth_mutex;
-    app_context.azimuth_mutex = &azimuth_mutex;
-    std::deque<float> azimuth_buffer;
-    app_context.azimuth_buffer = &azimuth_buffer;
-    std::mutex socket_mutex;
-    std::thread read_orientation_thread(read_orientation, socket, &cliaddr, &socket_mutex, &azimuth_mutex,
-                                        &azimuth_buffer);
-
-    nlohmann::json json;
+    // The captions were compiled from merged_captions.N.json at build time (see tools/caption_compiler.cpp), so
+    // loading them is just mapping the file.
     os.str("");
     os.clear();
-    os << "resources/captions/merged_captions." << video_section << ".json";
+    os << "resources/captions/merged_captions." << video_section << ".track";
     std::string captions_path = os.str();
     std::cout << "Captions path = " << captions_path << std::endl;
-    std::ifstream captions_file(captions_path.c_str());
-    captions_file >> json;
-    auto caption_model = CaptionModel();
+    auto caption_track = CaptionTrack::open(captions_path);
+    if (!caption_track) {
+        exit(EXIT_FAILURE);
+    }
+    auto caption_model = CaptionModel(&juror_metrics);
     app_context.caption_model = &caption_model;
+    CaptionSnapshot caption_snapshot;
+    app_context.caption_snapshot = &caption_snapshot;
 
     // Wait for data to start getting transmitted from the phone
-    // before we start playing our video on VLC and rendering captions.
-    while (azimuth_buffer.size() < MOVING_AVG_SIZE) {
+    // before we start playing our video on VLC and rendering captions. The wait sleeps until the network thread says
+    // there's progress, and closing the window (or Ctrl+C, escape, or q) cancels it.
+    timespec wait_cpu_start{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &wait_cpu_start);
+    const auto wait_start = std::chrono::steady_clock::now();
+    auto last_percent = -1;
+    const auto startup = startup_gate.wait(std::chrono::seconds(STARTUP_TIMEOUT_SECONDS),
+                                           std::chrono::milliseconds(STARTUP_POLL_MS), [&](double progress) {
+        SDL_Event startup_event;
+        while (SDL_PollEvent(&startup_event)) {
+            if (startup_event.type == SDL_QUIT || (startup_event.type == SDL_KEYDOWN &&
+                                                   (startup_event.key.keysym.sym == SDLK_ESCAPE ||
+                                                    startup_event.key.keysym.sym == SDLK_q))) {
+                return false;
+            }
+        }
+        const auto percent = static_cast<int>(progress * 100);
+        if (percent != last_percent) {
+            std::cout << "Waiting for the HWD's orientation to settle: " << percent << "%" << std::endl;
+            last_percent = percent;
+        }
+        return true;
+    });
+    timespec wait_cpu_end{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &wait_cpu_end);
+    timespec process_cpu{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &process_cpu);
+    const auto wait_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wait_start).count();
+    const auto wait_cpu_seconds = (wait_cpu_end.tv_sec - wait_cpu_start.tv_sec) +
+                                  (wait_cpu_end.tv_nsec - wait_cpu_start.tv_nsec) / 1e9;
+    std::cout << "Waited " << wait_seconds << " s for the HWD, using " << wait_cpu_seconds
+              << " s of CPU on the main thread; " << process_cpu.tv_sec + process_cpu.tv_nsec / 1e9
+              << " s of CPU used in total before playback." << std::endl;
+    if (startup != StartupGate::Outcome::Ready) {
+        if (startup == StartupGate::Outcome::TimedOut) {
+            std::cerr << "The HWD's orientation didn't settle within " << STARTUP_TIMEOUT_SECONDS << " seconds."
+                      << std::endl;
+        } else {
+            std::cout << "Cancelled before playback." << std::endl;
+        }
+        network.stop();
+        exit(startup == StartupGate::Outcome::TimedOut ? EXIT_FAILURE : EXIT_SUCCESS);
     }
     libvlc_media_player_play(mp);
-    std::thread play_captions_thread(start_caption_stream, socket, &cliaddr, &socket_mutex, &json, &caption_model);
+    std::thread play_captions_thread(start_caption_stream, &network, caption_track.get(), &caption_model,
+                                     &playback_clock);
     SDL_Event event;
     bool done = false;
     int action = 0;
@@ -310,6 +448,27 @@ int main(int argc, char *argv[]) {
                         app_context.y = app_context.window_height * 0.75;
                     }
                     break;
+                case SDL_RENDER_TARGETS_RESET:
+                    // The renderer dropped the contents of its render targets, which the cached captions are.
+                    SDL_LockMutex(app_context.mutex);
+                    if (caption_cache) {
+                        caption_cache->clear();
+                    }
+                    SDL_UnlockMutex(app_context.mutex);
+                    break;
+                case SDL_RENDER_DEVICE_RESET:
+                    // The renderer lost all of its textures, so upload the images and glyphs again before the next
+                    // frame.
+                    SDL_LockMutex(app_context.mutex);
+                    if (caption_cache) {
+                        caption_cache->clear();
+                    }
+                    assets->reload();
+                    for (const auto &[font, atlas]: font_atlases) {
+                        atlas->reload(app_context.renderer);
+                    }
+                    SDL_UnlockMutex(app_context.mutex);
+                    break;
             }
         }
 
@@ -330,6 +489,43 @@ int main(int argc, char *argv[]) {
 
         SDL_Delay(1000 / 10);
     }
+    // Stop VLC from rendering any more frames before we tear down what it renders with.
+    libvlc_media_player_stop(mp);
+    network.stop();
+    const auto network_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - network_start).count();
+    for (size_t i = 0; i < network.size(); ++i) {
+        const auto &shard = network.shard(i);
+        std::cout << "Shard " << i << ": received " << shard.received_count() << " orientations ("
+                  << shard.received_count() / network_seconds << "/s) in " << shard.receive_call_count()
+                  << " receive calls, " << shard.send_call_count() << " sends, sent "
+                  << shard.retransmits().retransmits() << " captions again, gave up on "
+                  << shard.retransmits().abandoned();
+        if (shard.misrouted_count()) {
+            std::cout << ", dropped " << shard.misrouted_count() << " from other shards' HWDs";
+        }
+        std::cout << "." << std::endl;
+    }
+    std::cout << sessions.active_count() << " HWDs connected." << std::endl;
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        if (!sessions.at(i).active()) {
+            continue;
+        }
+        std::cout << "HWD " << i << " orientations: " << sessions.at(i).link_stats << std::endl;
+    }
+    if (network.dropped_count()) {
+        std::cout << "Dropped " << network.dropped_count() << " outbound datagrams." << std::endl;
+    }
+    if (caption_cache) {
+        const auto lookups = caption_cache->hits() + caption_cache->misses();
+        std::cout << "Caption texture cache: " << caption_cache->hits() << " hits, " << caption_cache->misses()
+                  << " misses (" << (lookups ? 100.0 * caption_cache->hits() / lookups : 0.0) << "% hits), "
+                  << caption_cache->reuses() << " of the misses reused a texture" << std::endl;
+        caption_cache.reset();
+    }
+    assets.reset();
+    smallest_font_atlas.reset();
+    medium_font_atlas.reset();
+    largest_font_atlas.reset();
     TTF_CloseFont(smallest_font);
     SDL_DestroyMutex(app_context.mutex);
     SDL_DestroyRenderer(app_context.renderer);
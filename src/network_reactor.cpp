@@ -0,0 +1,608 @@
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "network_reactor.hpp"
+
+NetworkReactor::NetworkReactor(int socket, SessionTable *sessions, OrientationHandler on_orientation,
+                               NetworkBackend backend, size_t shard) : socket(socket), shard(shard),
+                                                                       backend(backend),
+                                                         on_orientation(std::move(on_orientation)),
+                                                         sessions(sessions) {
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        std::cerr << "Couldn't set up the network reactor: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    // Have the kernel stamp every datagram with when it arrived, before it sat in the socket's queue.
+    const int enable = 1;
+    if (setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+        std::cerr << "Couldn't enable receive timestamps: " << strerror(errno) << std::endl;
+    }
+    if (this->backend == NetworkBackend::IoUring && !set_up_io_uring()) {
+        std::cerr << "io_uring isn't available, falling back to epoll." << std::endl;
+        this->backend = NetworkBackend::Epoll;
+    }
+    if (this->backend == NetworkBackend::Epoll && !set_up_epoll()) {
+        std::cerr << "Couldn't set up the network reactor: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+bool NetworkReactor::set_up_epoll() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        return false;
+    }
+    for (size_t i = 0; i < RECEIVE_BATCH; ++i) {
+        receive_vectors[i] = iovec{receive_buffers[i].data(), MAX_DATAGRAM_SIZE};
+        receive_headers[i].msg_hdr.msg_iov = &receive_vectors[i];
+        receive_headers[i].msg_hdr.msg_iovlen = 1;
+        receive_headers[i].msg_hdr.msg_name = &receive_senders[i];
+        receive_headers[i].msg_hdr.msg_control = receive_controls[i].data();
+    }
+    epoll_event socket_event{};
+    socket_event.events = EPOLLIN;
+    socket_event.data.fd = socket;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket, &socket_event);
+    epoll_event wake_event{};
+    wake_event.events = EPOLLIN;
+    wake_event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake_event);
+    return true;
+}
+
+bool NetworkReactor::set_up_io_uring() {
+#ifdef HAVE_IO_URING_MULTISHOT
+    // Each buffer holds what the kernel says about the datagram, then its sender and control messages, then the
+    // datagram itself.
+    io_uring_receive_header.msg_namelen = sizeof(sockaddr_in);
+    io_uring_receive_header.msg_controllen = CMSG_SPACE(sizeof(timespec));
+    const auto buffer_size = sizeof(io_uring_recvmsg_out) + io_uring_receive_header.msg_namelen +
+                             io_uring_receive_header.msg_controllen + MAX_DATAGRAM_SIZE;
+    ring = IoUringRing::create(IO_URING_ENTRIES, IO_URING_BUFFERS, buffer_size);
+    return ring != nullptr;
+#else
+    return false;
+#endif
+}
+
+NetworkReactor::~NetworkReactor() {
+    stop();
+    close(wake_fd);
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+}
+
+bool NetworkReactor::multicast_captions(const sockaddr_in &group, in_addr interface, bool sender) {
+    multicast = true;
+    multicast_sender = sender;
+    multicast_group = group;
+    if (!sender) {
+        return true;
+    }
+    // Keep the captions in the room: a TTL of 1 doesn't leave the local network.
+    const unsigned char ttl = 1;
+    if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0 ||
+        setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+        std::cerr << "Couldn't set up multicast: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void NetworkReactor::start(int cpu) {
+    running = true;
+    thread = std::thread(&NetworkReactor::run, this);
+    if (cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        const auto error = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+        if (error) {
+            std::cerr << "Couldn't pin network shard " << shard << " to CPU " << cpu << ": " << strerror(error)
+                      << std::endl;
+        }
+    }
+}
+
+void NetworkReactor::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    running = false;
+    const uint64_t one = 1;
+    write(wake_fd, &one, sizeof(one));
+    thread.join();
+}
+
+bool NetworkReactor::send(const uint8_t *data, size_t size) {
+    return enqueue(data, size, false, 0);
+}
+
+bool NetworkReactor::send_caption(const uint8_t *data, size_t size, int message_id, int chunk_id) {
+    return enqueue(data, size, true, caption_key(message_id, chunk_id));
+}
+
+bool NetworkReactor::enqueue(const uint8_t *data, size_t size, bool reliable, uint64_t key) {
+    if (size > MAX_DATAGRAM_SIZE) {
+        std::cerr << "Datagram of " << size << " bytes is too large to send." << std::endl;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (queue_size == QUEUE_CAPACITY) {
+            ++dropped;
+            return false;
+        }
+        auto &datagram = queue[(queue_head + queue_size) % QUEUE_CAPACITY];
+        datagram.reliable = reliable;
+        datagram.key = key;
+        datagram.size = size;
+        std::memcpy(datagram.data.data(), data, size);
+        ++queue_size;
+    }
+    const uint64_t one = 1;
+    write(wake_fd, &one, sizeof(one));
+    return true;
+}
+
+uint64_t NetworkReactor::dropped_count() const {
+    return dropped;
+}
+
+uint64_t NetworkReactor::receive_call_count() const {
+    return receive_calls;
+}
+
+uint64_t NetworkReactor::received_count() const {
+    return received;
+}
+
+uint64_t NetworkReactor::misrouted_count() const {
+    return misrouted;
+}
+
+uint64_t NetworkReactor::send_call_count() const {
+    return send_calls;
+}
+
+const RetransmitWindow &NetworkReactor::retransmits() const {
+    return retransmit_window;
+}
+
+/**
+ * @return When the kernel received a datagram, in nanoseconds since the Unix epoch, or now if it didn't say.
+ */
+static int64_t receive_time(const msghdr &header) {
+    timespec time{};
+    bool stamped = false;
+    for (auto control = CMSG_FIRSTHDR(&header); control; control = CMSG_NXTHDR(const_cast<msghdr *>(&header), control)) {
+        if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS) {
+            std::memcpy(&time, CMSG_DATA(control), sizeof(time));
+            stamped = true;
+        }
+    }
+    if (!stamped) {
+        clock_gettime(CLOCK_REALTIME, &time);
+    }
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+NetworkBackend NetworkReactor::network_backend() const {
+    return backend;
+}
+
+void NetworkReactor::run() {
+    switch (backend) {
+        case NetworkBackend::Epoll:
+            run_epoll();
+            break;
+        case NetworkBackend::IoUring:
+            run_io_uring();
+            if (!running) {
+                break;
+            }
+            // The ring has failed. Carry on with epoll, rather than leaving the socket unread.
+            std::cerr << "io_uring failed on network shard " << shard << ", falling back to epoll." << std::endl;
+            ring.reset();
+            backend = NetworkBackend::Epoll;
+            if (!set_up_epoll()) {
+                std::cerr << "Couldn't set up the network reactor: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            // Waiting to write was a poll on the ring, so it has to be set up again with epoll.
+            if (waiting_to_write) {
+                waiting_to_write = false;
+                set_waiting_to_write(true);
+            }
+            run_epoll();
+            break;
+    }
+}
+
+void NetworkReactor::run_epoll() {
+    std::array<epoll_event, 2> events{};
+    while (running) {
+        // Wake up often while there are captions that might have to be sent again, and otherwise only to look for
+        // idle sessions.
+        const auto timeout = static_cast<int>(retransmit_window.has_unacknowledged() ? RetransmitWindow::TICK.count()
+                                                                                     : MAINTENANCE_TICK.count());
+        const auto ready = epoll_wait(epoll_fd, events.data(), events.size(), timeout);
+        if (ready < 0) {
+            if (errno != EINTR) {
+                std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+                return;
+            }
+            continue;
+        }
+        for (auto i = 0; i < ready; ++i) {
+            if (events[i].data.fd == wake_fd) {
+                uint64_t count;
+                read(wake_fd, &count, sizeof(count));
+                send_all();
+            } else {
+                if (events[i].events & EPOLLIN) {
+                    receive_all();
+                }
+                if (events[i].events & EPOLLOUT) {
+                    send_all();
+                }
+            }
+        }
+        retransmit();
+        maintain();
+    }
+}
+
+// What each io_uring completion is for, in its user_data.
+enum IoUringRequest : uint64_t {
+    IO_URING_RECEIVE,
+    IO_URING_WAKE,
+    IO_URING_WRITABLE,
+};
+
+#ifdef HAVE_IO_URING_MULTISHOT
+void NetworkReactor::run_io_uring() {
+    submit_io_uring_receive();
+    submit_io_uring_wake();
+    const auto tick = std::chrono::duration_cast<std::chrono::nanoseconds>(RetransmitWindow::TICK).count();
+    const timespec retransmit_timeout{0, static_cast<long>(tick)};
+    const auto maintenance_tick = std::chrono::duration_cast<std::chrono::nanoseconds>(MAINTENANCE_TICK).count();
+    const timespec maintenance_timeout{0, static_cast<long>(maintenance_tick)};
+    while (running) {
+        ++receive_calls;
+        // Wake up often while there are captions that might have to be sent again, and otherwise only to look for
+        // idle sessions.
+        if (!ring->wait(retransmit_window.has_unacknowledged() ? &retransmit_timeout : &maintenance_timeout)) {
+            return;
+        }
+        for (auto completion = ring->completion(); completion; completion = ring->completion()) {
+            switch (completion->user_data) {
+                case IO_URING_RECEIVE:
+                    receive_completion(*completion);
+                    break;
+                case IO_URING_WAKE: {
+                    uint64_t count;
+                    read(wake_fd, &count, sizeof(count));
+                    if (!(completion->flags & IORING_CQE_F_MORE)) {
+                        submit_io_uring_wake();
+                    }
+                    send_all();
+                    break;
+                }
+                case IO_URING_WRITABLE:
+                    waiting_to_write = false;
+                    send_all();
+                    break;
+            }
+            ring->consume();
+        }
+        dispatch();
+        retransmit();
+        maintain();
+    }
+}
+
+void NetworkReactor::submit_io_uring_receive() {
+    auto submission = ring->submission();
+    submission->opcode = IORING_OP_RECVMSG;
+    submission->fd = socket;
+    submission->addr = reinterpret_cast<uint64_t>(&io_uring_receive_header);
+    submission->len = 1;
+    submission->ioprio = IORING_RECV_MULTISHOT;
+    submission->flags = IOSQE_BUFFER_SELECT;
+    submission->buf_group = IoUringRing::BUFFER_GROUP;
+    submission->user_data = IO_URING_RECEIVE;
+}
+
+void NetworkReactor::submit_io_uring_wake() {
+    auto submission = ring->submission();
+    submission->opcode = IORING_OP_POLL_ADD;
+    submission->fd = wake_fd;
+    submission->poll32_events = POLLIN;
+    submission->len = IORING_POLL_ADD_MULTI;
+    submission->user_data = IO_URING_WAKE;
+}
+
+void NetworkReactor::receive_completion(const io_uring_cqe &completion) {
+    if (!(completion.flags & IORING_CQE_F_MORE)) {
+        // The kernel stops a multishot receive when it runs out of buffers, or on an error.
+        if (completion.res < 0 && completion.res != -ENOBUFS) {
+            std::cerr << "io_uring receive failed: " << strerror(-completion.res) << std::endl;
+        }
+        submit_io_uring_receive();
+    }
+    if (completion.res < 0 || !(completion.flags & IORING_CQE_F_BUFFER)) {
+        return;
+    }
+    const auto id = static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+    const auto buffer = ring->buffer(id);
+    io_uring_recvmsg_out out{};
+    std::memcpy(&out, buffer, sizeof(out));
+    const auto name = buffer + sizeof(out);
+    const auto control = name + io_uring_receive_header.msg_namelen;
+    const auto payload = control + io_uring_receive_header.msg_controllen;
+    if (out.namelen >= sizeof(sockaddr_in) && !(out.flags & MSG_TRUNC)) {
+        sockaddr_in sender{};
+        std::memcpy(&sender, name, sizeof(sender));
+        msghdr header{};
+        header.msg_control = control;
+        header.msg_controllen = out.controllen;
+        receive(sender, payload, out.payloadlen, receive_time(header));
+    }
+    ring->recycle(id);
+}
+
+void NetworkReactor::submit_io_uring_writable() {
+    // A one-shot poll, which clears waiting_to_write when it completes.
+    auto submission = ring->submission();
+    submission->opcode = IORING_OP_POLL_ADD;
+    submission->fd = socket;
+    submission->poll32_events = POLLOUT;
+    submission->user_data = IO_URING_WRITABLE;
+}
+#else
+// Without io_uring, set_up_io_uring() always fails, so the reactor runs on epoll and none of these are called.
+void NetworkReactor::run_io_uring() {}
+
+void NetworkReactor::submit_io_uring_receive() {}
+
+void NetworkReactor::submit_io_uring_wake() {}
+
+void NetworkReactor::submit_io_uring_writable() {}
+
+void NetworkReactor::receive_completion(const io_uring_cqe &) {}
+#endif
+
+void NetworkReactor::retransmit() {
+    const auto now = RetransmitWindow::clock::now();
+    if (now < next_retransmit) {
+        return;
+    }
+    next_retransmit = now + RetransmitWindow::TICK;
+    retransmit_window.retransmit(now, [this](size_t recipient, const uint8_t *data, size_t size) {
+        const auto &address = sessions->at(recipient).address;
+        if (sendto(socket, data, size, 0, (struct sockaddr *) &address, sizeof(address)) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Try again next tick, once the send buffer has drained.
+                return false;
+            }
+            std::cerr << "sendto failed: " << strerror(errno) << std::endl;
+            return true;
+        }
+        ++send_calls;
+        return true;
+    });
+}
+
+void NetworkReactor::maintain() {
+    const auto now = RetransmitWindow::clock::now();
+    if (now < next_maintenance) {
+        return;
+    }
+    next_maintenance = now + MAINTENANCE_TICK;
+    // Hand over what's been received first, since it may be from a session that's about to be closed.
+    dispatch();
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    sessions->expire_idle(shard, static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec,
+                          [this](size_t index) { retransmit_window.forget(index); });
+}
+
+void NetworkReactor::receive_all() {
+    for (size_t batch = 0; batch < MAX_RECEIVE_BATCHES; ++batch) {
+        // recvmmsg overwrites the lengths, so they have to be reset for every batch.
+        for (size_t i = 0; i < RECEIVE_BATCH; ++i) {
+            receive_headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            receive_headers[i].msg_hdr.msg_controllen = receive_controls[i].size();
+        }
+        const auto count = recvmmsg(socket, receive_headers.data(), RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+        ++receive_calls;
+        if (count < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "recvmmsg failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        for (auto i = 0; i < count; ++i) {
+            receive(receive_senders[i], receive_buffers[i].data(), receive_headers[i].msg_len,
+                    receive_time(receive_headers[i].msg_hdr));
+        }
+        dispatch();
+        // A short batch means the socket has been drained, so don't spend a system call finding that out.
+        if (static_cast<size_t>(count) < RECEIVE_BATCH) {
+            return;
+        }
+    }
+    // There's more to read, but send what's queued first. epoll is level-triggered, so the rest wakes the reactor
+    // again straight away.
+    if (!waiting_to_write) {
+        send_all();
+    }
+}
+
+bool NetworkReactor::receive_ack(const sockaddr_in &sender, const uint8_t *data, size_t size, int64_t receive_time) {
+    CaptionAck ack{};
+    if (size < sizeof(ack)) {
+        return false;
+    }
+    std::memcpy(&ack, data, sizeof(ack));
+    if (ack.magic != CAPTION_ACK_MAGIC) {
+        return false;
+    }
+    // Copy the NACKs out, since they aren't necessarily aligned in the datagram.
+    std::array<CaptionId, (MAX_DATAGRAM_SIZE - sizeof(CaptionAck)) / sizeof(CaptionId)> nacks{};
+    if (ack.nack_count > nacks.size() || sizeof(ack) + ack.nack_count * sizeof(CaptionId) > size) {
+        return true;
+    }
+    std::memcpy(nacks.data(), data + sizeof(ack), ack.nack_count * sizeof(CaptionId));
+    auto session = sessions->find_or_add(sender, shard, receive_time);
+    if (session && session->shard == shard) {
+        retransmit_window.acknowledge(sessions->index_of(session), ack, nacks.data());
+    }
+    return true;
+}
+
+void NetworkReactor::receive(const sockaddr_in &sender, const uint8_t *data, size_t size, int64_t receive_time) {
+    if (receive_ack(sender, data, size, receive_time)) {
+        return;
+    }
+    // Consecutive samples from the same HWD are handed over together. Each is parsed in place after the current batch,
+    // so that it can be moved to the start of the next one if it's from a different HWD.
+    if (batch_size == RECEIVE_BATCH) {
+        dispatch();
+    }
+    auto &sample = received_samples[batch_size];
+    if (!parse_orientation(data, size, receive_time, &sample)) {
+        return;
+    }
+    auto session = sessions->find_or_add(sender, shard, receive_time);
+    if (!session) {
+        return;
+    }
+    if (session->shard != shard) {
+        ++misrouted;
+        return;
+    }
+    if (!session->accept(sample)) {
+        return;
+    }
+    if (session != batch_session) {
+        dispatch();
+        received_samples[0] = sample;
+        batch_session = session;
+    }
+    ++batch_size;
+}
+
+void NetworkReactor::dispatch() {
+    if (batch_size) {
+        received += batch_size;
+        on_orientation(batch_session, received_samples.data(), batch_size);
+        batch_size = 0;
+    }
+}
+
+void NetworkReactor::send_all() {
+    Datagram datagram{};
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (queue_size == 0) {
+                break;
+            }
+            const auto &front = queue[queue_head];
+            datagram.reliable = front.reliable;
+            datagram.key = front.key;
+            datagram.size = front.size;
+            std::memcpy(datagram.data.data(), front.data.data(), front.size);
+        }
+        const auto recipients = sessions->size();
+        // Only a datagram that this shard should have sent, and that reached no one, is dropped. Another shard sends
+        // captions to the multicast group, and to its own sessions.
+        auto responsible = false;
+        if (datagram.reliable && multicast) {
+            // One send reaches every HWD in the group.
+            if (multicast_sender && !send_to(multicast_group, datagram)) {
+                return;
+            }
+            responsible = multicast_sender;
+        } else {
+            for (; next_recipient < recipients; ++next_recipient) {
+                const auto &session = sessions->at(next_recipient);
+                if (!session.active() || session.shard != shard) {
+                    continue;
+                }
+                front_addressed = true;
+                if (!send_to(session.address, datagram)) {
+                    // Carry on from this session when the socket drains.
+                    return;
+                }
+            }
+            next_recipient = 0;
+            responsible = front_addressed || sessions->active_count() == 0;
+        }
+        if (responsible && !front_sent) {
+            ++dropped;
+        }
+        front_sent = front_addressed = false;
+        if (datagram.reliable) {
+            retransmit_window.sent(datagram.key, datagram.data.data(), datagram.size, recipients,
+                                   RetransmitWindow::clock::now());
+        }
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue_head = (queue_head + 1) % QUEUE_CAPACITY;
+        --queue_size;
+    }
+    set_waiting_to_write(false);
+}
+
+/**
+ * Sends the datagram at the front of the queue to one address, and notes whether it has reached anyone.
+ * @return false if the socket's send buffer is full, in which case the datagram should be sent again once it drains.
+ * A datagram that couldn't be sent for any other reason isn't sent again.
+ */
+bool NetworkReactor::send_to(const sockaddr_in &address, const Datagram &datagram) {
+    if (sendto(socket, datagram.data.data(), datagram.size, 0, (struct sockaddr *) &address, sizeof(address)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            set_waiting_to_write(true);
+            return false;
+        }
+        std::cerr << "sendto failed: " << strerror(errno) << std::endl;
+        return true;
+    }
+    ++send_calls;
+    front_sent = true;
+    return true;
+}
+
+void NetworkReactor::set_waiting_to_write(bool waiting) {
+    if (waiting == waiting_to_write) {
+        return;
+    }
+    if (backend == NetworkBackend::IoUring) {
+        if (waiting) {
+            submit_io_uring_writable();
+            waiting_to_write = true;
+        }
+        return;
+    }
+    waiting_to_write = waiting;
+    uint32_t events = EPOLLIN;
+    if (waiting) {
+        events |= EPOLLOUT;
+    }
+    epoll_event socket_event{};
+    socket_event.events = events;
+    socket_event.data.fd = socket;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, socket, &socket_event);
+}
@@ -0,0 +1,68 @@
+#include <thread>
+#include "network_shards.hpp"
+
+NetworkShards::NetworkShards(const std::vector<int> &sockets, SessionTable *sessions,
+                             const NetworkReactor::OrientationHandler &on_orientation, NetworkBackend backend) {
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        reactors.push_back(std::make_unique<NetworkReactor>(sockets[i], sessions, on_orientation, backend, i));
+    }
+}
+
+bool NetworkShards::multicast_captions(const sockaddr_in &group, in_addr interface) {
+    // Every shard keeps the captions to send again to its own sessions, but only the first sends them to the group.
+    auto multicasting = true;
+    for (size_t i = 0; i < reactors.size(); ++i) {
+        multicasting &= reactors[i]->multicast_captions(group, interface, i == 0);
+    }
+    return multicasting;
+}
+
+void NetworkShards::start() {
+    // A single reactor is left to the scheduler, as it was before there were shards.
+    const auto cpus = std::thread::hardware_concurrency();
+    for (size_t i = 0; i < reactors.size(); ++i) {
+        reactors[i]->start(reactors.size() > 1 && cpus ? static_cast<int>(i % cpus) : -1);
+    }
+}
+
+void NetworkShards::stop() {
+    for (auto &reactor: reactors) {
+        reactor->stop();
+    }
+}
+
+bool NetworkShards::send(const uint8_t *data, size_t size) {
+    auto queued = true;
+    for (auto &reactor: reactors) {
+        queued &= reactor->send(data, size);
+    }
+    return queued;
+}
+
+bool NetworkShards::send_caption(const uint8_t *data, size_t size, int message_id, int chunk_id) {
+    auto queued = true;
+    for (auto &reactor: reactors) {
+        queued &= reactor->send_caption(data, size, message_id, chunk_id);
+    }
+    return queued;
+}
+
+size_t NetworkShards::size() const {
+    return reactors.size();
+}
+
+const NetworkReactor &NetworkShards::shard(size_t index) const {
+    return *reactors[index];
+}
+
+NetworkBackend NetworkShards::network_backend() const {
+    return reactors.front()->network_backend();
+}
+
+uint64_t NetworkShards::dropped_count() const {
+    uint64_t dropped = 0;
+    for (const auto &reactor: reactors) {
+        dropped += reactor->dropped_count();
+    }
+    return dropped;
+}
@@ -0,0 +1,117 @@
+#include <cmath>
+#include "orientation_estimators.hpp"
+
+constexpr double PI = 3.14159265358979323846;
+
+const char *orientation_filter_name(OrientationFilterType type) {
+    switch (type) {
+        case OrientationFilterType::Boxcar:
+            return "boxcar";
+        case OrientationFilterType::OneEuro:
+            return "one_euro";
+        case OrientationFilterType::Kalman:
+            return "kalman";
+    }
+    return "unknown";
+}
+
+double wrap_angle(double angle) {
+    return std::remainder(angle, 2 * PI);
+}
+
+void BoxcarEstimator::evict_oldest() {
+    sin_sum -= sines[oldest];
+    cos_sum -= cosines[oldest];
+    oldest = (oldest + 1) % CAPACITY;
+    --count;
+}
+
+AzimuthEstimate BoxcarEstimator::update(float azimuth, int64_t time) {
+    while (count > 0 && times[oldest] <= time - WINDOW) {
+        evict_oldest();
+    }
+    if (count == CAPACITY) {
+        evict_oldest();
+    }
+    const auto next = (oldest + count) % CAPACITY;
+    sines[next] = std::sin(azimuth);
+    cosines[next] = std::cos(azimuth);
+    times[next] = time;
+    sin_sum += sines[next];
+    cos_sum += cosines[next];
+    ++count;
+    if (--until_refresh == 0) {
+        until_refresh = CAPACITY;
+        // Adding and subtracting leaves rounding error behind in the sums, so start them afresh every so often.
+        sin_sum = cos_sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sin_sum += sines[(oldest + i) % CAPACITY];
+            cos_sum += cosines[(oldest + i) % CAPACITY];
+        }
+    }
+    return {static_cast<float>(std::atan2(sin_sum, cos_sum)), 0};
+}
+
+/**
+ * @return The smoothing factor of an exponential low-pass filter with the given cutoff, sampled at the given interval.
+ */
+static double smoothing_factor(double cutoff, double interval) {
+    const auto time_constant = 1 / (2 * PI * cutoff);
+    return 1 / (1 + time_constant / interval);
+}
+
+AzimuthEstimate OneEuroEstimator::update(float azimuth, double interval) {
+    if (!started) {
+        started = true;
+        last_raw = unwrapped = filtered = azimuth;
+        filtered_velocity = 0;
+        return {azimuth, 0};
+    }
+    const auto change = wrap_angle(azimuth - last_raw);
+    unwrapped += change;
+    last_raw = azimuth;
+    const auto raw_velocity = change / interval;
+    filtered_velocity += smoothing_factor(DERIVATIVE_CUTOFF, interval) * (raw_velocity - filtered_velocity);
+    const auto cutoff = MIN_CUTOFF + BETA * std::abs(filtered_velocity);
+    filtered += smoothing_factor(cutoff, interval) * (unwrapped - filtered);
+    return {static_cast<float>(wrap_angle(filtered)), static_cast<float>(filtered_velocity)};
+}
+
+void OneEuroEstimator::reset() {
+    started = false;
+}
+
+AzimuthEstimate KalmanEstimator::update(float measured, double interval) {
+    if (!started) {
+        started = true;
+        azimuth = measured;
+        velocity = 0;
+        p00 = MEASUREMENT_NOISE;
+        p01 = 0;
+        // We've no idea how fast the head is turning yet: a few radians per second either way.
+        p11 = 4;
+        return {measured, 0};
+    }
+    // Predict: the head kept turning at the same rate, give or take the acceleration since.
+    const auto dt = interval;
+    azimuth += velocity * dt;
+    const auto q = ACCELERATION_NOISE;
+    p00 += dt * (2 * p01 + dt * p11) + q * dt * dt * dt / 3;
+    p01 += dt * p11 + q * dt * dt / 2;
+    p11 += q * dt;
+    // Correct, measuring how far off the prediction was the short way around the circle.
+    const auto innovation = wrap_angle(measured - azimuth);
+    const auto s = p00 + MEASUREMENT_NOISE;
+    const auto k0 = p00 / s;
+    const auto k1 = p01 / s;
+    azimuth = wrap_angle(azimuth + k0 * innovation);
+    velocity += k1 * innovation;
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+    return {static_cast<float>(azimuth), static_cast<float>(velocity)};
+}
+
+void KalmanEstimator::reset() {
+    started = false;
+}
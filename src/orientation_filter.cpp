@@ -0,0 +1,108 @@
+#include <algorithm>
+#include "orientation_filter.hpp"
+
+// Samples that claim to have been taken at the same time as the last one are taken to be this far apart.
+constexpr double MIN_INTERVAL = 0.0005; // seconds
+
+void OrientationFilter::set_type(OrientationFilterType type) {
+    filter_type = type;
+}
+
+OrientationFilterType OrientationFilter::type() const {
+    return filter_type;
+}
+
+double OrientationFilter::interval_between(const OrientationSample &previous, const OrientationSample &sample) {
+    const auto nanoseconds = previous.has_sequence && sample.has_sequence
+                             ? sample.headset_time - previous.headset_time
+                             : sample.receive_time - previous.receive_time;
+    return std::max(static_cast<double>(nanoseconds) / 1e9, MIN_INTERVAL);
+}
+
+void OrientationFilter::push(const OrientationSample *samples, size_t sample_count) {
+    if (sample_count == 0) {
+        return;
+    }
+    AzimuthEstimate estimate{};
+    for (size_t i = 0; i < sample_count; ++i) {
+        const auto &sample = samples[i];
+        const auto interval = has_previous ? interval_between(previous, sample) : 0.0;
+        if (!has_previous || interval > MAX_INTERVAL) {
+            one_euro.reset();
+            kalman.reset();
+            run_start = sample.receive_time;
+        }
+        switch (filter_type) {
+            case OrientationFilterType::Boxcar:
+                estimate = boxcar.update(sample.azimuth, sample.receive_time);
+                break;
+            case OrientationFilterType::OneEuro:
+                estimate = one_euro.update(sample.azimuth, interval);
+                break;
+            case OrientationFilterType::Kalman:
+                estimate = kalman.update(sample.azimuth, interval);
+                break;
+        }
+        previous = sample;
+        has_previous = true;
+    }
+
+    const auto v = version.load(std::memory_order_relaxed);
+    version.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    published_azimuth.store(estimate.azimuth, std::memory_order_relaxed);
+    published_velocity.store(estimate.velocity, std::memory_order_relaxed);
+    published_time.store(previous.receive_time, std::memory_order_relaxed);
+    published_span.store(previous.receive_time - run_start, std::memory_order_relaxed);
+    version.store(v + 2, std::memory_order_release);
+}
+
+void OrientationFilter::reset() {
+    boxcar = BoxcarEstimator();
+    one_euro.reset();
+    kalman.reset();
+    has_previous = false;
+    previous = OrientationSample{};
+
+    const auto v = version.load(std::memory_order_relaxed);
+    version.store(v + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    published_azimuth.store(0, std::memory_order_relaxed);
+    published_velocity.store(0, std::memory_order_relaxed);
+    published_time.store(0, std::memory_order_relaxed);
+    published_span.store(-1, std::memory_order_relaxed);
+    version.store(v + 2, std::memory_order_release);
+}
+
+OrientationFilter::Snapshot OrientationFilter::snapshot() const {
+    Snapshot snapshot{};
+    while (true) {
+        const auto before = version.load(std::memory_order_acquire);
+        snapshot.azimuth = published_azimuth.load(std::memory_order_relaxed);
+        snapshot.velocity = published_velocity.load(std::memory_order_relaxed);
+        snapshot.time = published_time.load(std::memory_order_relaxed);
+        snapshot.span = published_span.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before % 2 == 0 && version.load(std::memory_order_relaxed) == before) {
+            return snapshot;
+        }
+    }
+}
+
+double OrientationFilter::azimuth() const {
+    return snapshot().azimuth;
+}
+
+double OrientationFilter::azimuth_at(int64_t time) const {
+    const auto estimate = snapshot();
+    if (estimate.span < 0) {
+        return 0;
+    }
+    const auto ahead = std::clamp<int64_t>(time - estimate.time, 0, MAX_PREDICTION);
+    return wrap_angle(estimate.azimuth + estimate.velocity * static_cast<double>(ahead) / 1e9);
+}
+
+double OrientationFilter::settle_progress() const {
+    const auto span = published_span.load(std::memory_order_acquire);
+    return std::clamp(static_cast<double>(span) / SETTLE_TIME, 0.0, 1.0);
+}
@@ -0,0 +1,29 @@
+#include <cstring>
+#include "orientation_sample.hpp"
+#include "cog-flatbuffer-definitions/orientation_message_generated.h"
+
+bool parse_orientation(const uint8_t *data, size_t size, int64_t receive_time, OrientationSample *sample) {
+    OrientationHeader header{};
+    sample->has_sequence = false;
+    if (size >= sizeof(header)) {
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic == ORIENTATION_HEADER_MAGIC) {
+            sample->has_sequence = true;
+            sample->sequence = header.sequence;
+            sample->headset_time = header.headset_time;
+            data += sizeof(header);
+            size -= sizeof(header);
+        }
+    }
+    flatbuffers::Verifier verifier(data, size);
+    if (!cog::VerifyOrientationMessageBuffer(verifier)) {
+        return false;
+    }
+    if (!sample->has_sequence) {
+        sample->sequence = 0;
+        sample->headset_time = 0;
+    }
+    sample->azimuth = cog::GetOrientationMessage(data)->azimuth();
+    sample->receive_time = receive_time;
+    return true;
+}
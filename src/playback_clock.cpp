@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cmath>
+#include "playback_clock.hpp"
+
+using milliseconds = std::chrono::duration<double, std::milli>;
+
+void SyncStats::add_lateness(double lateness) {
+    ++captions;
+    total_lateness += lateness;
+    max_lateness = std::max(max_lateness, lateness);
+}
+
+void SyncStats::add_drift(double drift) {
+    ++drift_samples;
+    total_absolute_drift += std::abs(drift);
+    max_absolute_drift = std::max(max_absolute_drift, std::abs(drift));
+    last_drift = drift;
+}
+
+std::ostream &operator<<(std::ostream &out, const SyncStats &stats) {
+    out << stats.captions << " captions, lateness mean "
+        << (stats.captions ? stats.total_lateness / stats.captions : 0.0) << " ms, max " << stats.max_lateness
+        << " ms";
+    if (stats.drift_samples) {
+        out << "; drift from VLC mean " << stats.total_absolute_drift / stats.drift_samples << " ms, max "
+            << stats.max_absolute_drift << " ms, last " << stats.last_drift << " ms";
+    }
+    return out;
+}
+
+PlaybackClock::PlaybackClock(libvlc_media_player_t *media_player) : media_player(media_player) {}
+
+void PlaybackClock::mark_started() {
+    // This is called for every frame, so only take the lock for the first one.
+    if (started.load(std::memory_order_acquire)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(start_mutex);
+        if (started.load(std::memory_order_relaxed)) {
+            return;
+        }
+        epoch = clock::now();
+        started.store(true, std::memory_order_release);
+    }
+    start_condition.notify_all();
+}
+
+void PlaybackClock::wait_for_start() {
+    std::unique_lock<std::mutex> lock(start_mutex);
+    start_condition.wait(lock, [this] { return started.load(std::memory_order_relaxed); });
+}
+
+void PlaybackClock::correct() {
+    const auto media_time = libvlc_media_player_get_time(media_player);
+    if (media_time < 0) {
+        return;
+    }
+    // Positive drift means our clock is ahead of the video, so captions would be early.
+    const auto drift = milliseconds(clock::now() - epoch).count() - static_cast<double>(media_time);
+    sync_stats.add_drift(drift);
+    epoch += std::chrono::duration_cast<clock::duration>(milliseconds(drift * CORRECTION_GAIN));
+}
+
+PlaybackClock::clock::time_point PlaybackClock::deadline(double media_time) {
+    if (media_player) {
+        correct();
+    }
+    return epoch + std::chrono::duration_cast<clock::duration>(milliseconds(media_time));
+}
+
+void PlaybackClock::record_lateness(clock::time_point deadline) {
+    sync_stats.add_lateness(milliseconds(clock::now() - deadline).count());
+}
+
+const SyncStats &PlaybackClock::stats() const {
+    return sync_stats;
+}
@@ -1,6 +1,5 @@
 #include <iostream>
 #include "presentation_methods.hpp"
-#include "orientation.hpp"
 
 std::optional<SDL_Rect> rectangle_intersection(const SDL_Rect *a, const SDL_Rect *b) {
     int intersection_tl_x = std::max(a->x, b->x);
@@ -16,49 +15,55 @@ std::optional<SDL_Rect> rectangle_intersection(const SDL_Rect *a, const SDL_Rect
 }
 
 
-void render_surface_as_texture(SDL_Renderer *renderer, SDL_Surface *surface, SDL_Rect *source_rect,
-                               SDL_Rect *destination_rect) {
-    auto texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-    SDL_RenderCopy(renderer, texture, source_rect, destination_rect);
-    SDL_DestroyTexture(texture);
-}
-
 std::tuple<int, int>
-render_text(SDL_Renderer *renderer, TTF_Font *font, const std::string &text, int x, int y,
-            const SDL_Color *foreground_color, const SDL_Color *background_color) {
-    auto text_surface = TTF_RenderText_Shaded_Wrapped(font, text.c_str(), *foreground_color,
-                                                      *background_color,
-                                                      WRAP_LENGTH);
-    int w = text_surface->w;
-    int h = text_surface->h;
-    auto destination_rect = SDL_Rect{x, y, w, h};
-    render_surface_as_texture(renderer, text_surface, nullptr, &destination_rect);
-    SDL_FreeSurface(text_surface);
-    return std::make_tuple(w, h);
+render_caption(const AppContext *context, int x, int y, const SDL_Rect *source_rect) {
+    const auto snapshot = context->caption_snapshot;
+    // Captions are laid out in the speaker's font, so they have to be drawn in it too.
+    auto font = context->juror_font_sizes->at(snapshot->juror);
+    auto atlas = context->font_atlases->at(font);
+    auto destination_rect = SDL_Rect{x, y, snapshot->width, snapshot->height};
+    if (source_rect) {
+        destination_rect = SDL_Rect{x + source_rect->x, y + source_rect->y, source_rect->w, source_rect->h};
+    }
+
+    SDL_Texture *texture = nullptr;
+    if (context->caption_cache) {
+        const CaptionTextureKey key{snapshot->generation, font, *context->foreground_color,
+                                    *context->background_color, CaptionModel::LINE_WIDTH};
+        texture = context->caption_cache->get(context->renderer, atlas, key, snapshot);
+    }
+    if (texture) {
+        // The caption is in the top-left of the texture, which is as wide as a full line.
+        const auto caption_rect = SDL_Rect{0, 0, snapshot->width, snapshot->height};
+        SDL_RenderCopy(context->renderer, texture, source_rect ? source_rect : &caption_rect, &destination_rect);
+    } else {
+        // Without a cached texture, draw the glyphs straight onto the frame, clipped the same way.
+        SDL_RenderSetClipRect(context->renderer, &destination_rect);
+        atlas->render_text(context->renderer, snapshot->text, x, y, context->foreground_color,
+                           context->background_color);
+        SDL_RenderSetClipRect(context->renderer, nullptr);
+    }
+    return std::make_tuple(snapshot->width, snapshot->height);
 }
 
 
-void render_nonregistered_captions(const AppContext *context) {
-    auto left_x = calculate_display_x_from_orientation(context);
-    auto[juror, text] = context->caption_model->get_current_text();
+void render_nonregistered_captions(const AppContext *context, const FrameContext *frame) {
+    const auto left_x = frame->azimuth_x;
+    const auto &text = context->caption_snapshot->text;
     if (text.empty()) {
         return;
     }
-    render_text(context->renderer, context->medium_font, text, left_x, context->y, context->foreground_color,
-                context->background_color);
+    render_caption(context, left_x, context->y, nullptr);
 }
 
 
-void render_nonregistered_captions_with_indicators(const AppContext *context) {
-    auto left_x = calculate_display_x_from_orientation(context);
-    auto[juror, text] = context->caption_model->get_current_text();
+void render_nonregistered_captions_with_indicators(const AppContext *context, const FrameContext *frame) {
+    const auto left_x = frame->azimuth_x;
+    const auto &text = context->caption_snapshot->text;
     if (text.empty()) {
         return;
     }
-    const auto[text_width, text_height] = render_text(context->renderer,
-                                                      context->medium_font, text, left_x, context->y,
-                                                      context->foreground_color, context->background_color);
+    const auto[text_width, text_height] = render_caption(context, left_x, context->y, nullptr);
     bool should_show_back_arrow = false;
     bool should_show_forward_arrow = true;
 
@@ -66,60 +71,45 @@ void render_nonregistered_captions_with_indicators(const AppContext *context) {
         return;
     }
     int x = 0;
-    SDL_Surface *arrow_surface = nullptr;
+    const Asset *arrow = nullptr;
     if (should_show_back_arrow) {
-        arrow_surface = context->back_arrow;
-        x = left_x - arrow_surface->w;
+        arrow = context->back_arrow;
+        x = left_x - arrow->w;
     } else if (should_show_forward_arrow) {
-        arrow_surface = context->forward_arrow;
+        arrow = context->forward_arrow;
         x = left_x + text_width;
     }
-    auto destination_rect = SDL_Rect{x, context->y, arrow_surface->w, arrow_surface->h};
-    render_surface_as_texture(context->renderer, arrow_surface, nullptr, &destination_rect);
+    // The arrows were uploaded once at startup, so this is just a copy of their texture.
+    auto destination_rect = SDL_Rect{x, context->y, arrow->w, arrow->h};
+    SDL_RenderCopy(context->renderer, arrow->texture, nullptr, &destination_rect);
 }
 
-void render_registered_captions(const AppContext *context) {
-    const auto[juror, text] = context->caption_model->get_current_text();
+void render_registered_captions(const AppContext *context, const FrameContext *frame) {
+    const auto &text = context->caption_snapshot->text;
     if (text.empty()) {
         return;
     }
-    // We've previously identified where on the screen to place the captions underneath the jurors. Those are represented as percentages of the VLC surface fov_x_2/height
-    auto[left_x_percent, left_y_percent] = context->juror_positions->at(juror);
-    // Now we just re-hydrate those values with the current size of the VLC surface to get where the captions should be positioned.
-    int text_x = left_x_percent * context->display_rect.w;
-    int text_y = left_y_percent * context->display_rect.h;
-    // Retrieve the font to be used for the current juror
-    auto font = context->juror_font_sizes->at(juror);
-    // And let's create a surface of the text we've been given.
-
-    auto text_surface = TTF_RenderText_Shaded_Wrapped(font, text.c_str(), *context->foreground_color,
-                                                      *context->background_color,
-                                                      WRAP_LENGTH);
-
+    // We've previously identified where on the screen to place the captions underneath the jurors, and the frame
+    // context has already re-hydrated that with the current size of the VLC surface.
     // Now, here's where we do our clipping behavior.
     // The general idea is as follows:
     //
-    // The text surface has a fov_x_2 and height, and we know the text_x and text_y of where we're going to draw the
-    // caption (assuming no clipping at all).
-    const auto surface_rect = SDL_Rect{text_x, text_y, text_surface->w, text_surface->h};
+    // The caption was laid out when its last word arrived, so we already know its width and height, and we know the
+    // text_x and text_y of where we're going to draw the caption (assuming no clipping at all).
+    const auto &surface_rect = frame->caption_rect;
+    const auto text_x = surface_rect.x;
+    const auto text_y = surface_rect.y;
 
     // We also have a pre-defined field-of-view (FOV), which is how much the person would be able to see if they were
-    // wearing a realistic HWD.
-    auto azimuth = filtered_azimuth(context->azimuth_buffer, context->azimuth_mutex);
-    const auto half_fov_in_radians = to_radians(HALF_FOV);
-
-    // We can calculate how much of the window fov_x_2 the FOV covers with some trig...
-    const auto fov_x = angle_to_pixel_position(azimuth) - angle_to_pixel_position(to_radians(HALF_FOV));
-    const auto fov_x_2 = angle_to_pixel_position(azimuth) + angle_to_pixel_position(to_radians(HALF_FOV));
-    const auto fov_region = SDL_Rect{fov_x, 0, fov_x_2 - fov_x, context->window_height};
+    // wearing a realistic HWD. The frame context worked out how much of the window that covers.
+    const auto &fov_region = frame->fov_region;
 
     SDL_SetRenderDrawBlendMode(context->renderer, SDL_BLENDMODE_BLEND);
     SDL_SetRenderDrawColor(context->renderer, 0, 0, 0, 100);
     SDL_SetRenderDrawBlendMode(context->renderer, SDL_BLENDMODE_NONE);
     SDL_RenderFillRect(context->renderer, &fov_region);
     SDL_SetRenderDrawColor(context->renderer, 255, 0, 0, 255);
-    const auto azimuth_x = angle_to_pixel_position(azimuth);
-    SDL_RenderDrawLine(context->renderer, azimuth_x, 0, azimuth_x, context->window_height);
+    SDL_RenderDrawLine(context->renderer, frame->azimuth_x, 0, frame->azimuth_x, context->window_height);
 
     // and then find the intersection between the FOV region (which extends from the top to the bottom of the window, to
     // keep things easy) and the text surface rectangle, which should give us a rectangle indicating what part of the
@@ -127,25 +117,21 @@ void render_registered_captions(const AppContext *context) {
     auto intersection = rectangle_intersection(&surface_rect, &fov_region);
     // If they don't intersect at all, there's nothing to render, we stop here.
     if (!intersection.has_value()) {
-        SDL_FreeSurface(text_surface);
         return;
     }
     SDL_Rect intersection_rect = intersection.value();
 
     // One thing to note: our intersection rectangle could be located anywhere on the screen
     // (0 <= intersection_x <= WINDOW_WIDTH) and (0 <= intersection_y <= WINDOW_HEIGHT)
-    // But that's not what we want! We want to know how much of the TEXT SURFACE we want to render.
+    // But that's not what we want! We want to know how much of the CAPTION we want to render.
     // So let's calculate how far intersection_rect.x is from text_x, and how far intersection_rect.y is from text_y
-    SDL_Rect text_surface_clip_region = {
+    SDL_Rect caption_clip_region = {
             intersection_rect.x - text_x, // This won't ever be negative, because intersection_x >= text_x always
             intersection_rect.y - text_y, // Same here
-            intersection_rect.w, // And this is how much of the text surface we want to clip
+            intersection_rect.w, // And this is how much of the caption we want to clip
             intersection_rect.h
     };
-    // Now, last thing: We now know what part of the text surface we need to clip, but we need to RENDER it at the
-    // intersection between the FOV and the caption rectangle.
-    // We're going to copy the pixels from the region outlined by text_surface_clip_region on text_surface to the
-    // pixels outlined by intersection_rect. That should give us the clipped caption on the display!
-    render_surface_as_texture(context->renderer, text_surface, &text_surface_clip_region, &intersection_rect);
-    SDL_FreeSurface(text_surface);
-}
\ No newline at end of file
+    // Now, last thing: we copy the part of the (cached) caption texture outlined by caption_clip_region to the
+    // intersection between the FOV and the caption rectangle. That should give us the clipped caption on the display!
+    render_caption(context, text_x, text_y, &caption_clip_region);
+}
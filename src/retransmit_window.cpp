@@ -0,0 +1,112 @@
+#include <cstring>
+#include "retransmit_window.hpp"
+
+uint64_t caption_key(int32_t message_id, int32_t chunk_id) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(message_id)) << 32 | static_cast<uint32_t>(chunk_id);
+}
+
+RetransmitWindow::Slot &RetransmitWindow::at(size_t age_from_oldest) {
+    return slots[(head + age_from_oldest) % CAPACITY];
+}
+
+void RetransmitWindow::sent(uint64_t key, const uint8_t *data, size_t size, size_t recipients,
+                            clock::time_point now) {
+    if (size > MAX_DATAGRAM_SIZE) {
+        return;
+    }
+    if (count == CAPACITY) {
+        abandoned_count += at(0).unacknowledged.count();
+        head = (head + 1) % CAPACITY;
+        --count;
+    }
+    auto &slot = at(count++);
+    slot.key = key;
+    slot.size = size;
+    std::memcpy(slot.data.data(), data, size);
+    slot.unacknowledged.reset();
+    slot.negatively_acknowledged.reset();
+    for (size_t recipient = 0; recipient < recipients; ++recipient) {
+        if (acknowledging[recipient]) {
+            slot.unacknowledged.set(recipient);
+        }
+        slot.last_sent[recipient] = now;
+    }
+}
+
+void RetransmitWindow::acknowledge(size_t recipient, const CaptionAck &ack, const CaptionId *nacks) {
+    acknowledging.set(recipient);
+    if (ack.message_id >= 0) {
+        const auto acknowledged_through = caption_key(ack.message_id, ack.chunk_id);
+        for (size_t i = 0; i < count; ++i) {
+            auto &slot = at(i);
+            if (slot.key <= acknowledged_through) {
+                slot.unacknowledged.reset(recipient);
+                slot.negatively_acknowledged.reset(recipient);
+            }
+        }
+    }
+    for (uint32_t n = 0; n < ack.nack_count; ++n) {
+        const auto key = caption_key(nacks[n].message_id, nacks[n].chunk_id);
+        for (size_t i = 0; i < count; ++i) {
+            auto &slot = at(i);
+            if (slot.key == key) {
+                // Captions sent before the recipient first acknowledged one weren't being tracked for it.
+                slot.unacknowledged.set(recipient);
+                slot.negatively_acknowledged.set(recipient);
+                break;
+            }
+        }
+    }
+}
+
+void RetransmitWindow::forget(size_t recipient) {
+    acknowledging.reset(recipient);
+    for (size_t i = 0; i < count; ++i) {
+        auto &slot = at(i);
+        slot.unacknowledged.reset(recipient);
+        slot.negatively_acknowledged.reset(recipient);
+    }
+}
+
+void RetransmitWindow::retransmit(clock::time_point now, const Sender &send) {
+    auto budget = RETRANSMITS_PER_TICK;
+    // Oldest first, since those are the closest to being given up on.
+    for (size_t i = 0; i < count && budget; ++i) {
+        auto &slot = at(i);
+        if (slot.unacknowledged.none()) {
+            continue;
+        }
+        for (size_t recipient = 0; recipient < SessionTable::MAX_SESSIONS && budget; ++recipient) {
+            if (!slot.unacknowledged[recipient]) {
+                continue;
+            }
+            if (!slot.negatively_acknowledged[recipient] && now - slot.last_sent[recipient] < TIMEOUT) {
+                continue;
+            }
+            if (!send(recipient, slot.data.data(), slot.size)) {
+                return;
+            }
+            slot.last_sent[recipient] = now;
+            slot.negatively_acknowledged.reset(recipient);
+            ++retransmit_count;
+            --budget;
+        }
+    }
+}
+
+bool RetransmitWindow::has_unacknowledged() const {
+    for (size_t i = 0; i < count; ++i) {
+        if (slots[(head + i) % CAPACITY].unacknowledged.any()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t RetransmitWindow::retransmits() const {
+    return retransmit_count;
+}
+
+uint64_t RetransmitWindow::abandoned() const {
+    return abandoned_count;
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <arpa/inet.h>
+#include "session_table.hpp"
+
+void LinkStats::add_delay(double delay) {
+    if (delay_samples == 0) {
+        mean_delay = min_delay = delay;
+    } else {
+        mean_delay += SMOOTHING * (delay - mean_delay);
+        mean_jitter += SMOOTHING * (std::abs(delay - last_delay) - mean_jitter);
+        min_delay = std::min(min_delay, delay);
+    }
+    last_delay = delay;
+    ++delay_samples;
+}
+
+std::ostream &operator<<(std::ostream &out, const LinkStats &stats) {
+    out << stats.received << " received, " << stats.lost << " lost, " << stats.out_of_order << " out of order";
+    if (stats.resyncs) {
+        out << ", restarted " << stats.resyncs << " times";
+    }
+    if (stats.delay_samples) {
+        // Unless the HWD's clock is synchronized with ours, only the delay above the minimum means anything.
+        out << "; delay mean " << stats.mean_delay << " ms (" << stats.mean_delay - stats.min_delay
+            << " ms above min), jitter " << stats.mean_jitter << " ms";
+    }
+    return out;
+}
+
+bool Session::active() const {
+    return endpoint.load(std::memory_order_acquire) != 0;
+}
+
+bool Session::accept(const OrientationSample &sample) {
+    if (sample.has_sequence) {
+        // Compare sequence numbers as a signed difference, so that they can wrap around.
+        const auto ahead = static_cast<int64_t>(static_cast<int32_t>(sample.sequence - last_sequence));
+        if (has_sequence && (std::abs(ahead) > RESYNC_JUMP || sample.receive_time - last_receive_time > RESYNC_GAP)) {
+            has_sequence = false;
+            ++link_stats.resyncs;
+        }
+        if (has_sequence && ahead <= 0) {
+            // If this fills a gap that was counted as lost, it wasn't lost after all, just late.
+            const auto behind = -ahead;
+            if (behind > 0 && behind < LATE_WINDOW && (missing >> behind & 1)) {
+                missing &= ~(uint64_t{1} << behind);
+                --link_stats.lost;
+            }
+            ++link_stats.out_of_order;
+            return false;
+        }
+        if (has_sequence) {
+            link_stats.lost += ahead - 1;
+            // Shift the gaps back to stay relative to the new last_sequence, and mark the ones this sample skipped.
+            const auto skipped = std::min(ahead - 1, LATE_WINDOW - 1);
+            missing = ahead < LATE_WINDOW ? missing << ahead : 0;
+            missing |= ((uint64_t{1} << skipped) - 1) << 1;
+        } else {
+            missing = 0;
+        }
+        has_sequence = true;
+        last_sequence = sample.sequence;
+        last_receive_time = sample.receive_time;
+    }
+    if (sample.headset_time) {
+        link_stats.add_delay(static_cast<double>(sample.receive_time - sample.headset_time) / 1e6);
+    }
+    ++link_stats.received;
+    return true;
+}
+
+void Session::reset() {
+    orientation.reset();
+    link_stats = LinkStats{};
+    has_sequence = false;
+    last_sequence = 0;
+    last_receive_time = 0;
+    missing = 0;
+}
+
+/**
+ * @return The address and port as one number. No HWD can send from port 0, so none of them is 0.
+ */
+static uint64_t endpoint_of(const sockaddr_in &address) {
+    return static_cast<uint64_t>(address.sin_addr.s_addr) << 16 | address.sin_port;
+}
+
+SessionTable::SessionTable(OrientationFilterType filter) {
+    for (auto &session: sessions) {
+        session.orientation.set_type(filter);
+    }
+}
+
+Session *SessionTable::find_or_add(const sockaddr_in &address, size_t shard, int64_t now) {
+    const auto endpoint = endpoint_of(address);
+    auto size = count.load(std::memory_order_acquire);
+    // There are only ever a handful of sessions, so a linear scan beats hashing the address.
+    for (size_t i = 0; i < size; ++i) {
+        if (sessions[i].endpoint.load(std::memory_order_acquire) == endpoint) {
+            sessions[i].last_heard.store(now, std::memory_order_relaxed);
+            return &sessions[i];
+        }
+    }
+    // Another shard may have added a session since, but it can't have been this address's.
+    std::lock_guard<std::mutex> lock(add_mutex);
+    size = count.load(std::memory_order_relaxed);
+    Session *session = nullptr;
+    for (size_t i = 0; i < size && !session; ++i) {
+        if (!sessions[i].active()) {
+            session = &sessions[i];
+        }
+    }
+    if (!session) {
+        if (size == MAX_SESSIONS) {
+            return nullptr;
+        }
+        session = &sessions[size];
+        count.store(size + 1, std::memory_order_release);
+    }
+    session->reset();
+    session->address = address;
+    session->shard = shard;
+    session->last_heard.store(now, std::memory_order_relaxed);
+    // Publish the address along with the session.
+    session->endpoint.store(endpoint, std::memory_order_release);
+    std::cout << "HWD " << index_of(session) << " connected from " << inet_ntoa(address.sin_addr) << ":"
+              << ntohs(address.sin_port) << " on shard " << shard << std::endl;
+    // If the display's HWD isn't sending, it follows the one that just connected.
+    const auto primary = primary_session.load(std::memory_order_relaxed);
+    if (primary != session && is_quiet(*primary, now)) {
+        primary_session.store(session, std::memory_order_release);
+    }
+    return session;
+}
+
+void SessionTable::expire_idle(size_t shard, int64_t now, const ExpiredHandler &on_expired) {
+    const auto size = count.load(std::memory_order_acquire);
+    Session *latest = nullptr;
+    for (size_t i = 0; i < size; ++i) {
+        auto &session = sessions[i];
+        if (!session.active()) {
+            continue;
+        }
+        const auto last_heard = session.last_heard.load(std::memory_order_relaxed);
+        if (session.shard == shard && now - last_heard > IDLE_TIMEOUT) {
+            std::lock_guard<std::mutex> lock(add_mutex);
+            session.endpoint.store(0, std::memory_order_release);
+            std::cout << "HWD " << i << " timed out. Its orientations: " << session.link_stats << std::endl;
+            on_expired(i);
+            continue;
+        }
+        if (!latest || last_heard > latest->last_heard.load(std::memory_order_relaxed)) {
+            latest = &session;
+        }
+    }
+    if (!latest) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(add_mutex);
+    const auto primary = primary_session.load(std::memory_order_relaxed);
+    if (latest != primary && latest->active() && is_quiet(*primary, now)) {
+        primary_session.store(latest, std::memory_order_release);
+        std::cout << "The display now follows HWD " << index_of(latest) << "." << std::endl;
+    }
+}
+
+bool SessionTable::is_quiet(const Session &session, int64_t now) const {
+    return !session.active() || now - session.last_heard.load(std::memory_order_relaxed) > PRIMARY_QUIET_TIME;
+}
+
+Session *SessionTable::primary() {
+    return primary_session.load(std::memory_order_acquire);
+}
+
+size_t SessionTable::size() const {
+    return count.load(std::memory_order_acquire);
+}
+
+size_t SessionTable::active_count() const {
+    const auto size = count.load(std::memory_order_acquire);
+    size_t active = 0;
+    for (size_t i = 0; i < size; ++i) {
+        active += sessions[i].active();
+    }
+    return active;
+}
+
+Session &SessionTable::at(size_t index) {
+    return sessions[index];
+}
+
+size_t SessionTable::index_of(const Session *session) const {
+    return session - sessions.data();
+}
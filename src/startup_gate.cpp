@@ -0,0 +1,65 @@
+#include <algorithm>
+#include "startup_gate.hpp"
+
+void StartupGate::report(double new_progress) {
+    new_progress = std::clamp(new_progress, 0.0, 1.0);
+    const auto step = static_cast<int>(new_progress * PROGRESS_STEPS);
+    if (step == reported_step || open.load(std::memory_order_relaxed)) {
+        return;
+    }
+    reported_step = step;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        progress = new_progress;
+        if (step == PROGRESS_STEPS) {
+            open.store(true, std::memory_order_release);
+        }
+    }
+    changed.notify_all();
+}
+
+void StartupGate::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    changed.notify_all();
+}
+
+bool StartupGate::is_open() const {
+    return open.load(std::memory_order_acquire);
+}
+
+StartupGate::Outcome StartupGate::wait(std::chrono::steady_clock::duration timeout,
+                                       std::chrono::steady_clock::duration poll_interval,
+                                       const std::function<bool(double progress)> &on_progress) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto last_progress = -1.0;
+    while (true) {
+        if (open.load(std::memory_order_relaxed)) {
+            return Outcome::Ready;
+        }
+        if (cancelled) {
+            return Outcome::Cancelled;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return Outcome::TimedOut;
+        }
+        if (progress == last_progress) {
+            changed.wait_until(lock, std::min(now + poll_interval, deadline));
+            if (open.load(std::memory_order_relaxed) || cancelled) {
+                continue;
+            }
+        }
+        // The callback may take a while, and may cancel, so it runs without the lock.
+        const auto current = last_progress = progress;
+        lock.unlock();
+        const auto carry_on = on_progress(current);
+        lock.lock();
+        if (!carry_on) {
+            cancelled = true;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#include <iostream>
+#include "text_layout.hpp"
+
+GlyphMetrics::GlyphMetrics(TTF_Font *font) : font(font), line_skip(TTF_FontLineSkip(font)) {
+    for (auto c = FIRST_GLYPH; c <= LAST_GLYPH; ++c) {
+        int min_x, max_x, min_y, max_y, glyph_advance;
+        if (TTF_GlyphMetrics(font, c, &min_x, &max_x, &min_y, &max_y, &glyph_advance) < 0) {
+            std::cerr << "TTF_GlyphMetrics failed for '" << static_cast<char>(c) << "': " << TTF_GetError()
+                      << std::endl;
+            glyph_advance = 0;
+        }
+        advances[c - FIRST_GLYPH] = glyph_advance;
+    }
+}
+
+int GlyphMetrics::advance(char c) const {
+    if (c < FIRST_GLYPH || c > LAST_GLYPH) {
+        c = '?';
+    }
+    return advances[c - FIRST_GLYPH];
+}
+
+int GlyphMetrics::measure(const std::string &text) const {
+    int width = 0;
+    for (const auto c: text) {
+        width += advance(c);
+    }
+    return width;
+}
+
+int GlyphMetrics::line_height() const {
+    return line_skip;
+}
+
+TTF_Font *GlyphMetrics::get_font() const {
+    return font;
+}
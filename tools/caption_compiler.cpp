@@ -0,0 +1,32 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sys/resource.h>
+#include "caption_track.hpp"
+
+/**
+ * Compiles a caption track from JSON (resources/captions/merged_captions.N.json) into the binary form that the
+ * server memory-maps at startup, and reports how long that took and the peak memory it needed.
+ * Usage: caption_compiler <input.json> <output.track>
+ */
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <input.json> <output.track>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::ifstream captions_file(argv[1]);
+    if (!captions_file) {
+        std::cerr << "Couldn't open " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (!compile_caption_track(captions_file, argv[2])) {
+        return EXIT_FAILURE;
+    }
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in kilobytes on Linux (and bytes on macOS).
+    std::cout << "Took " << elapsed.count() << " ms, peak RSS " << usage.ru_maxrss << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "nlohmann/json.hpp"
+#include "caption_track.hpp"
+
+/**
+ * Compiles a long transcript into a caption track twice, once streaming the JSON as caption_compiler does, and once
+ * parsing it into a DOM first, the way captions used to be loaded, and reports how long each took and the memory it
+ * needed.
+ *
+ * Usage: caption_load_benchmark [options]
+ *   --captions <dir>     Where merged_captions.1.json to merged_captions.4.json are (default resources/captions)
+ *   --repeat <count>     How many times over the four sections are in the transcript (default 60, about 10 hours)
+ *
+ * The transcript is written to a temporary file first, and each loader runs in a process of its own, so that its peak
+ * RSS is its own and not the larger of the two.
+ */
+
+constexpr int VIDEO_SECTIONS = 4;
+
+struct Options {
+    std::string captions_path = "resources/captions";
+    size_t repeat = 60;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--captions") {
+            options->captions_path = value;
+        } else if (option == "--repeat") {
+            options->repeat = std::stoul(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->repeat > 0;
+}
+
+/**
+ * Writes the four sections' captions, repeated, into one JSON array.
+ * @return The size of the transcript in bytes, or 0 if a section couldn't be read.
+ */
+static size_t write_transcript(const Options &options, std::ostream &transcript) {
+    std::vector<std::string> sections;
+    for (auto section = 1; section <= VIDEO_SECTIONS; ++section) {
+        const auto path = options.captions_path + "/merged_captions." + std::to_string(section) + ".json";
+        std::ifstream file(path);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        auto captions = contents.str();
+        // Only the captions between the brackets, so that the sections can be joined into one array.
+        const auto first = captions.find('['), last = captions.rfind(']');
+        if (!file || first == std::string::npos || last == std::string::npos || last <= first) {
+            std::cerr << "Couldn't read the captions in " << path << std::endl;
+            return 0;
+        }
+        sections.push_back(captions.substr(first + 1, last - first - 1));
+    }
+    size_t size = 2;
+    transcript << '[';
+    for (size_t i = 0; i < options.repeat; ++i) {
+        for (const auto &section: sections) {
+            if (size > 2) {
+                transcript << ',';
+                ++size;
+            }
+            transcript << section;
+            size += section.size();
+        }
+    }
+    transcript << ']';
+    return size;
+}
+
+/**
+ * Compiles the track the way captions used to be loaded: the whole transcript is parsed into a DOM, and then the DOM is
+ * walked for each caption.
+ */
+static bool compile_caption_track_from_dom(std::istream &caption_json, const std::string &path) {
+    nlohmann::json captions;
+    try {
+        caption_json >> captions;
+    } catch (const nlohmann::json::exception &ex) {
+        std::cerr << "Couldn't parse captions: " << ex.what() << std::endl;
+        return false;
+    }
+    std::vector<CaptionEvent> events;
+    std::string text_pool;
+    for (const auto &caption: captions) {
+        CaptionEvent event{};
+        const auto &text = caption["text"].get_ref<const std::string &>();
+        event.time = caption["delay"].get<double>();
+        event.text_offset = text_pool.size();
+        event.text_length = text.size();
+        event.message_id = caption["message_id"].get<int32_t>();
+        event.chunk_id = caption["chunk_id"].get<int32_t>();
+        event.speaker = juror_from_string(caption["speaker_id"].get<std::string>());
+        text_pool.append(text).append(1, '\0');
+        events.push_back(event);
+    }
+
+    CaptionTrackHeader header{CaptionTrack::MAGIC, CaptionTrack::VERSION, static_cast<uint32_t>(events.size()),
+                              static_cast<uint32_t>(text_pool.size())};
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(events.data()),
+               static_cast<std::streamsize>(events.size() * sizeof(CaptionEvent)));
+    file.write(text_pool.data(), static_cast<std::streamsize>(text_pool.size()));
+    return static_cast<bool>(file);
+}
+
+/**
+ * Runs one loader in a child process, and prints how long it took, and the child's peak RSS.
+ * @return Whether the loader wrote the track.
+ */
+static bool run(const std::string &name, bool (*compile)(std::istream &, const std::string &),
+                const std::string &transcript_path, const std::string &track_path) {
+    int elapsed_pipe[2];
+    if (pipe(elapsed_pipe) < 0) {
+        std::cerr << "Couldn't create a pipe: " << strerror(errno) << std::endl;
+        return false;
+    }
+    const auto child = fork();
+    if (child < 0) {
+        std::cerr << "Couldn't fork: " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (child == 0) {
+        close(elapsed_pipe[0]);
+        const auto start = std::chrono::steady_clock::now();
+        std::ifstream transcript(transcript_path);
+        const auto compiled = compile(transcript, track_path);
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        const auto elapsed_ms = elapsed.count();
+        // The parent can't trust a time it only got part of, so a short write fails the run.
+        if (write(elapsed_pipe[1], &elapsed_ms, sizeof(elapsed_ms)) != sizeof(elapsed_ms)) {
+            _exit(EXIT_FAILURE);
+        }
+        _exit(compiled ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    close(elapsed_pipe[1]);
+    double elapsed_ms = 0;
+    const auto read_size = read(elapsed_pipe[0], &elapsed_ms, sizeof(elapsed_ms));
+    close(elapsed_pipe[0]);
+    int status = 0;
+    struct rusage usage{};
+    wait4(child, &status, 0, &usage);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        std::cerr << name << " failed to compile the transcript" << std::endl;
+        return false;
+    }
+    if (read_size != sizeof(elapsed_ms)) {
+        std::cerr << name << " didn't report how long it took" << std::endl;
+        return false;
+    }
+    // ru_maxrss is in kilobytes on Linux.
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(12) << elapsed_ms << std::setw(18)
+              << usage.ru_maxrss / 1024.0 << std::endl;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--captions <dir>] [--repeat <count>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    char transcript_path[] = "/tmp/caption_load_benchmark.XXXXXX";
+    const auto transcript_fd = mkstemp(transcript_path);
+    if (transcript_fd < 0) {
+        std::cerr << "Couldn't create a temporary file: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    close(transcript_fd);
+    const auto track_path = std::string(transcript_path) + ".track";
+    size_t transcript_size;
+    {
+        std::ofstream transcript(transcript_path, std::ios::trunc);
+        transcript_size = write_transcript(options, transcript);
+    }
+
+    auto passed = transcript_size > 0;
+    if (passed) {
+        std::cout << "Transcript of " << options.repeat << " x " << VIDEO_SECTIONS << " sections, "
+                  << std::fixed << std::setprecision(1) << transcript_size / 1e6 << " MB" << std::endl;
+        std::cout << std::left << std::setw(10) << "loader" << std::right << std::setw(12) << "time (ms)"
+                  << std::setw(18) << "peak RSS (MB)" << std::endl;
+        passed = run("SAX", compile_caption_track, transcript_path, track_path) &&
+                 run("DOM", compile_caption_track_from_dom, transcript_path, track_path);
+    }
+    std::remove(transcript_path);
+    std::remove(track_path.c_str());
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
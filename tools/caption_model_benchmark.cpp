@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL2/SDL_ttf.h>
+#include "captions.hpp"
+#include "text_layout.hpp"
+
+/**
+ * Measures how long the render thread takes to get the current captions while the caption thread adds words, with the
+ * lock-free CaptionModel, and with the same model behind one mutex, the way it used to be shared.
+ *
+ * Usage: caption_model_benchmark [options]
+ *   --font <path>        The font captions are laid out in (default resources/fonts/Roboto-Regular.ttf)
+ *   --rate <Hz>          How many words the caption thread adds per second, or 0 for as fast as it can (default 0)
+ *   --seconds <s>        How long to run each model for, at most (default 2)
+ *
+ * The render thread reads back to back, as if every frame were instant, so that it overlaps as many words as it can.
+ * For each model, it reports percentiles of how long a read took, and how many words were added meanwhile.
+ */
+
+constexpr int FONT_SIZE = 24;
+// Each model stops after this many reads, if it gets there before --seconds, so that recording them never allocates.
+constexpr size_t MAX_READS = 1 << 22;
+// The speaker changes every this many words, which clears the captions.
+constexpr size_t WORDS_PER_SPEAKER = 40;
+const char *const WORDS[] = {"I", "don't", "think", "the", "boy", "could", "have", "heard", "the", "old", "man",
+                             "say", "that", "from", "across", "the", "street,", "not", "with", "the", "el",
+                             "going", "by."};
+
+struct Options {
+    std::string font_path = "resources/fonts/Roboto-Regular.ttf";
+    double rate = 0;
+    double seconds = 2;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--font") {
+            options->font_path = value;
+        } else if (option == "--rate") {
+            options->rate = std::stod(value);
+        } else if (option == "--seconds") {
+            options->seconds = std::stod(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->rate >= 0 && options->seconds > 0;
+}
+
+/**
+ * The model as it was before it was lock-free: both threads take the same mutex, for as long as a word or a read takes.
+ */
+class LockedCaptionModel {
+private:
+    std::mutex mutex;
+    CaptionModel model;
+
+public:
+    explicit LockedCaptionModel(const std::map<cog::Juror, const GlyphMetrics *> *juror_metrics) : model(
+            juror_metrics) {}
+
+    void add_word(const std::string &new_word, cog::Juror speaker) {
+        std::lock_guard<std::mutex> lock(mutex);
+        model.add_word(new_word, speaker);
+    }
+
+    void get_current_text(CaptionSnapshot *snapshot) {
+        std::lock_guard<std::mutex> lock(mutex);
+        model.get_current_text(snapshot);
+    }
+};
+
+static double percentile(std::vector<double> &values, double fraction) {
+    const auto nth = values.begin() + static_cast<ptrdiff_t>(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+template<typename Model>
+static void run(const std::string &name, const std::map<cog::Juror, const GlyphMetrics *> *juror_metrics,
+                const Options &options) {
+    Model model(juror_metrics);
+    std::atomic<bool> running{true};
+    size_t words = 0;
+    std::thread writer([&] {
+        const auto period = options.rate > 0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1 / options.rate)) : std::chrono::steady_clock::duration::zero();
+        std::string word;
+        for (auto next = std::chrono::steady_clock::now(); running; next += period) {
+            const auto speaker = (words / WORDS_PER_SPEAKER) % 2 ? cog::Juror_JurorA : cog::Juror_JurorB;
+            word.assign(WORDS[words % (sizeof(WORDS) / sizeof(WORDS[0]))]);
+            model.add_word(word, speaker);
+            ++words;
+            if (options.rate > 0) {
+                std::this_thread::sleep_until(next);
+            }
+        }
+    });
+
+    CaptionSnapshot snapshot;
+    std::vector<double> latencies;
+    latencies.reserve(MAX_READS);
+    const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(options.seconds));
+    for (auto now = std::chrono::steady_clock::now(); now < end && latencies.size() < MAX_READS;) {
+        model.get_current_text(&snapshot);
+        const auto after = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double, std::nano>(after - now).count());
+        now = after;
+    }
+    running = false;
+    writer.join();
+
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(12) << latencies.size()
+              << std::setw(12) << words;
+    for (const auto fraction: {0.5, 0.99, 0.999}) {
+        std::cout << std::setw(12) << percentile(latencies, fraction);
+    }
+    std::cout << std::setw(14) << *std::max_element(latencies.begin(), latencies.end()) << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--font <path>] [--rate <Hz>] [--seconds <s>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (TTF_Init() == -1) {
+        std::cerr << "TTF_Init failed: " << TTF_GetError() << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto font = TTF_OpenFont(options.font_path.c_str(), FONT_SIZE);
+    if (!font) {
+        std::cerr << "Couldn't open " << options.font_path << ": " << TTF_GetError() << std::endl;
+        return EXIT_FAILURE;
+    }
+    const GlyphMetrics metrics(font);
+    const std::map<cog::Juror, const GlyphMetrics *> juror_metrics{
+            {cog::Juror_JurorA, &metrics},
+            {cog::Juror_JurorB, &metrics},
+    };
+
+    std::cout << "Words ";
+    if (options.rate > 0) {
+        std::cout << "at " << options.rate << " Hz";
+    } else {
+        std::cout << "back to back";
+    }
+    std::cout << ", reads back to back, for up to " << options.seconds << " s each" << std::endl;
+    std::cout << std::left << std::setw(10) << "model" << std::right << std::setw(12) << "reads" << std::setw(12)
+              << "words" << std::setw(12) << "p50 (ns)" << std::setw(12) << "p99 (ns)" << std::setw(12)
+              << "p99.9 (ns)" << std::setw(14) << "max (ns)" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    run<CaptionModel>("lock-free", &juror_metrics, options);
+    run<LockedCaptionModel>("mutex", &juror_metrics, options);
+
+    TTF_CloseFont(font);
+    TTF_Quit();
+    return EXIT_SUCCESS;
+}
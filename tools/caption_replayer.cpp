@@ -0,0 +1,136 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "caption_track.hpp"
+#include "caption_transmitter.hpp"
+#include "network_shards.hpp"
+
+/**
+ * Sends a compiled caption track to HWDs on its schedule, the way the server does, but without playing the video.
+ * Together with headset_simulator, this exercises the server's networking on machines without a display or VLC.
+ *
+ * Usage: caption_replayer <track> [options]
+ *   --port <port>               The port to listen for HWDs on (default 65432)
+ *   --hwds <count>              How many HWDs to wait for before starting (default 1)
+ *   --seconds <s>               How much of the track to play (default all of it)
+ *   --multicast <addr:port>     Multicast captions to this group, rather than sending them to each HWD
+ *   --interface <addr>          The address of the interface to multicast from (default any)
+ */
+
+constexpr int DEFAULT_PORT = 65432;
+// How long to keep running after the last caption, for retransmits.
+constexpr auto LINGER = std::chrono::seconds(1);
+
+struct Options {
+    std::string track_path;
+    int port = DEFAULT_PORT;
+    size_t hwds = 1;
+    double seconds = -1;
+    std::string multicast_group;
+    std::string interface;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    if (argc < 2) {
+        return false;
+    }
+    options->track_path = argv[1];
+    for (auto i = 2; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--port") {
+            options->port = std::stoi(value);
+        } else if (option == "--hwds") {
+            options->hwds = std::stoul(value);
+        } else if (option == "--seconds") {
+            options->seconds = std::stod(value);
+        } else if (option == "--multicast") {
+            options->multicast_group = value;
+        } else if (option == "--interface") {
+            options->interface = value;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 0;
+}
+
+static bool parse_address(const std::string &address_str, sockaddr_in *address) {
+    const auto colon = address_str.find(':');
+    *address = sockaddr_in{};
+    address->sin_family = AF_INET;
+    if (colon == std::string::npos) {
+        return inet_pton(AF_INET, address_str.c_str(), &address->sin_addr) == 1;
+    }
+    address->sin_port = htons(std::stoi(address_str.substr(colon + 1)));
+    return inet_pton(AF_INET, address_str.substr(0, colon).c_str(), &address->sin_addr) == 1;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " <track> [--port <port>] [--hwds <count>] [--seconds <s>]"
+                  << " [--multicast <addr:port>] [--interface <addr>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto track = CaptionTrack::open(options.track_path);
+    if (!track) {
+        return EXIT_FAILURE;
+    }
+    const auto socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(options.port);
+    if (socket < 0 || bind(socket, (const sockaddr *) &address, sizeof(address)) < 0) {
+        std::cerr << "Couldn't listen on port " << options.port << ": " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SessionTable sessions;
+    NetworkShards network({socket}, &sessions, [](Session *, const OrientationSample *, size_t) {},
+                          NetworkBackend::Epoll);
+    if (!options.multicast_group.empty()) {
+        sockaddr_in group{}, interface{};
+        if (!parse_address(options.multicast_group, &group) || !IN_MULTICAST(ntohl(group.sin_addr.s_addr)) ||
+            (!options.interface.empty() && !parse_address(options.interface, &interface))) {
+            std::cerr << "Not a multicast group and interface: " << options.multicast_group << " "
+                      << options.interface << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (!network.multicast_captions(group, interface.sin_addr)) {
+            return EXIT_FAILURE;
+        }
+    }
+    network.start();
+    std::cout << "Waiting for " << options.hwds << " HWDs on port " << options.port << std::endl;
+    while (sessions.active_count() < options.hwds) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    CaptionTransmitter transmitter(&network);
+    std::string text;
+    size_t sent = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &event: *track) {
+        if (options.seconds >= 0 && event.time > options.seconds * 1000) {
+            break;
+        }
+        std::this_thread::sleep_until(
+                start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double, std::milli>(event.time)));
+        text = track->text(event);
+        transmitter.transmit(text, track->speaker(event), track->speaker(event), event.message_id, event.chunk_id);
+        ++sent;
+    }
+    std::this_thread::sleep_for(LINGER);
+    network.stop();
+    const auto &shard = network.shard(0);
+    std::cout << "Sent " << sent << " captions to " << sessions.active_count() << " HWDs in " << shard.send_call_count()
+              << " sends (" << shard.retransmits().retransmits() << " of them retransmits)" << std::endl;
+    return EXIT_SUCCESS;
+}
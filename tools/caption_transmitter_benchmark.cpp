@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "caption_track.hpp"
+#include "caption_transmitter.hpp"
+#include "network_shards.hpp"
+#include "cog-flatbuffer-definitions/orientation_message_generated.h"
+
+/**
+ * Sends the words of a caption track to an HWD over loopback, one at a time, the way captions used to be sent (a new
+ * 1024-byte builder per word, and the whole 1024 bytes sent from the caption thread), and through a CaptionTransmitter,
+ * and reports what each costs.
+ *
+ * Usage: caption_transmitter_benchmark [options]
+ *   --track <path>       The compiled caption track to take words from
+ *                        (default resources/captions/merged_captions.1.track)
+ *   --messages <count>   How many words to send each way (default 100000)
+ *
+ * For each, it reports:
+ *   serialize:  how long building the CaptionMessage takes, without sending it
+ *   caption:    how long the caption thread spends on each word, building and sending or queueing it
+ *   delivered:  percentiles of how long from starting on a word until the HWD has received it
+ *   bytes:      how long each datagram the HWD received was
+ */
+
+constexpr int64_t NANOSECONDS = 1'000'000'000;
+constexpr size_t OLD_DATAGRAM_SIZE = 1024;
+// The HWD sends its orientation this often, in words, so that its session doesn't time out during a long run.
+constexpr size_t ORIENTATION_INTERVAL = 10000;
+
+struct Options {
+    std::string track_path = "resources/captions/merged_captions.1.track";
+    size_t messages = 100000;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--track") {
+            options->track_path = value;
+        } else if (option == "--messages") {
+            options->messages = std::stoul(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->messages > 0;
+}
+
+/**
+ * What each way of sending costs, per word.
+ */
+struct Result {
+    double serialize_ns = 0;
+    double caption_ns = 0;
+    std::vector<double> delivered_ns;
+    size_t bytes = 0;
+};
+
+/**
+ * The caption thread's end of a way of sending words.
+ */
+class Sender {
+public:
+    virtual ~Sender() = default;
+
+    /**
+     * Builds a word's CaptionMessage without sending it.
+     * @return The size of the message.
+     */
+    virtual size_t serialize(const std::string &text, cog::Juror speaker, int message_id, int chunk_id) = 0;
+
+    virtual bool send(const std::string &text, cog::Juror speaker, int message_id, int chunk_id) = 0;
+};
+
+/**
+ * Captions as they used to be sent: a new builder for each word, and a full 1024-byte datagram sent to the HWD from the
+ * caption thread.
+ */
+class OldSender : public Sender {
+private:
+    int socket;
+    sockaddr_in hwd_address;
+
+public:
+    OldSender(int socket, const sockaddr_in &hwd_address) : socket(socket), hwd_address(hwd_address) {}
+
+    size_t serialize(const std::string &text, cog::Juror speaker, int message_id, int chunk_id) override {
+        flatbuffers::FlatBufferBuilder builder(OLD_DATAGRAM_SIZE);
+        builder.Finish(cog::CreateCaptionMessageDirect(builder, text.c_str(), speaker, speaker, message_id, chunk_id));
+        return builder.GetSize();
+    }
+
+    bool send(const std::string &text, cog::Juror speaker, int message_id, int chunk_id) override {
+        flatbuffers::FlatBufferBuilder builder(OLD_DATAGRAM_SIZE);
+        builder.Finish(cog::CreateCaptionMessageDirect(builder, text.c_str(), speaker, speaker, message_id, chunk_id));
+        return sendto(socket, builder.GetBufferPointer(), OLD_DATAGRAM_SIZE, 0, (const sockaddr *) &hwd_address,
+                      sizeof(hwd_address)) >= 0;
+    }
+};
+
+/**
+ * Captions as they're sent now, through a CaptionTransmitter that queues them on the network shards.
+ */
+class TransmitterSender : public Sender {
+private:
+    CaptionTransmitter transmitter;
+    // Built the way the transmitter builds its messages, since it doesn't serialize without sending.
+    flatbuffers::FlatBufferBuilder builder{OLD_DATAGRAM_SIZE};
+
+public:
+    explicit TransmitterSender(NetworkShards *network) : transmitter(network) {}
+
+    size_t serialize(const std::string &text, cog::Juror speaker, int message_id, int chunk_id) override {
+        builder.Clear();
+        builder.Finish(cog::CreateCaptionMessageDirect(builder, text.c_str(), speaker, speaker, message_id, chunk_id));
+        return builder.GetSize();
+    }
+
+    bool send(const std::string &text, cog::Juror speaker, int message_id, int chunk_id) override {
+        return transmitter.transmit(text, speaker, speaker, message_id, chunk_id);
+    }
+};
+
+static int64_t realtime_ns() {
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    return static_cast<int64_t>(time.tv_sec) * NANOSECONDS + time.tv_nsec;
+}
+
+static void send_orientation(int hwd_socket, const sockaddr_in &server, uint32_t *sequence) {
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(cog::CreateOrientationMessage(builder, 0));
+    const OrientationHeader header{ORIENTATION_HEADER_MAGIC, (*sequence)++, realtime_ns()};
+    std::vector<uint8_t> datagram(sizeof(header) + builder.GetSize());
+    std::memcpy(datagram.data(), &header, sizeof(header));
+    std::memcpy(datagram.data() + sizeof(header), builder.GetBufferPointer(), builder.GetSize());
+    sendto(hwd_socket, datagram.data(), datagram.size(), 0, (const sockaddr *) &server, sizeof(server));
+}
+
+static Result run(Sender *sender, const CaptionTrack &track, const Options &options, int hwd_socket,
+                  const sockaddr_in &server, uint32_t *sequence) {
+    Result result;
+    result.delivered_ns.reserve(options.messages);
+    std::string text;
+    const auto event_at = [&](size_t i) -> const CaptionEvent & {
+        return track.begin()[i % track.size()];
+    };
+
+    size_t total_size = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.messages; ++i) {
+        const auto &event = event_at(i);
+        text.assign(track.text(event));
+        total_size += sender->serialize(text, static_cast<cog::Juror>(event.speaker), event.message_id,
+                                        event.chunk_id);
+    }
+    result.serialize_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                          options.messages;
+
+    double caption_total = 0;
+    uint8_t datagram[NetworkReactor::MAX_DATAGRAM_SIZE];
+    for (size_t i = 0; i < options.messages; ++i) {
+        if (i % ORIENTATION_INTERVAL == 0) {
+            send_orientation(hwd_socket, server, sequence);
+        }
+        const auto &event = event_at(i);
+        start = std::chrono::steady_clock::now();
+        text.assign(track.text(event));
+        if (!sender->send(text, static_cast<cog::Juror>(event.speaker), event.message_id, event.chunk_id)) {
+            continue;
+        }
+        const auto sent = std::chrono::steady_clock::now();
+        const auto received = recv(hwd_socket, datagram, sizeof(datagram), 0);
+        if (received < 0) {
+            continue;
+        }
+        const auto delivered = std::chrono::steady_clock::now();
+        caption_total += std::chrono::duration<double, std::nano>(sent - start).count();
+        result.delivered_ns.push_back(std::chrono::duration<double, std::nano>(delivered - start).count());
+        result.bytes += received;
+    }
+    if (!result.delivered_ns.empty()) {
+        result.caption_ns = caption_total / result.delivered_ns.size();
+    }
+    // Keep the optimizer from dropping the serialize loop.
+    if (total_size == 0) {
+        std::cerr << "Every message was empty" << std::endl;
+    }
+    return result;
+}
+
+static double percentile(std::vector<double> &values, double fraction) {
+    const auto nth = values.begin() + static_cast<ptrdiff_t>(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+static void print(const std::string &name, Result *result, size_t messages) {
+    const auto delivered = result->delivered_ns.size();
+    std::cout << std::left << std::setw(14) << name << std::right << std::setw(16) << result->serialize_ns
+              << std::setw(14) << result->caption_ns;
+    if (delivered > 0) {
+        std::cout << std::setw(20) << percentile(result->delivered_ns, 0.5) / 1000
+                  << std::setw(20) << percentile(result->delivered_ns, 0.99) / 1000
+                  << std::setw(10) << static_cast<double>(result->bytes) / delivered;
+    }
+    std::cout << std::setw(14) << delivered << " of " << messages << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--track <path>] [--messages <count>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto track = CaptionTrack::open(options.track_path);
+    if (!track || track->size() == 0) {
+        std::cerr << "Couldn't open a caption track at " << options.track_path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const auto server_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    const auto hwd_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in server{}, hwd{};
+    server.sin_family = hwd.sin_family = AF_INET;
+    server.sin_addr.s_addr = hwd.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t server_size = sizeof(server), hwd_size = sizeof(hwd);
+    if (bind(server_socket, (const sockaddr *) &server, sizeof(server)) < 0 ||
+        getsockname(server_socket, (sockaddr *) &server, &server_size) < 0 ||
+        bind(hwd_socket, (const sockaddr *) &hwd, sizeof(hwd)) < 0 ||
+        getsockname(hwd_socket, (sockaddr *) &hwd, &hwd_size) < 0) {
+        std::cerr << "Couldn't bind to loopback: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    // A word that never arrives is counted as undelivered, rather than waited for.
+    timeval timeout{1, 0};
+    setsockopt(hwd_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    SessionTable sessions;
+    NetworkShards network({server_socket}, &sessions, [](Session *, const OrientationSample *, size_t) {},
+                          NetworkBackend::Epoll);
+    network.start();
+    uint32_t sequence = 0;
+    send_orientation(hwd_socket, server, &sequence);
+    for (auto waited = 0; sessions.active_count() == 0 && waited < 1000; ++waited) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (sessions.active_count() == 0) {
+        std::cerr << "The HWD never connected" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << options.messages << " words from " << options.track_path << ", one at a time over loopback"
+              << std::endl;
+    std::cout << std::left << std::setw(14) << "sender" << std::right << std::setw(16) << "serialize (ns)"
+              << std::setw(14) << "caption (ns)" << std::setw(20) << "delivered p50 (us)" << std::setw(20)
+              << "delivered p99 (us)" << std::setw(10) << "bytes" << std::setw(14) << "delivered" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    OldSender old_sender(server_socket, hwd);
+    auto old_result = run(&old_sender, *track, options, hwd_socket, server, &sequence);
+    print("1024 B", &old_result, options.messages);
+    TransmitterSender transmitter_sender(&network);
+    auto transmitter_result = run(&transmitter_sender, *track, options, hwd_socket, server, &sequence);
+    print("transmitter", &transmitter_result, options.messages);
+
+    network.stop();
+    close(hwd_socket);
+    close(server_socket);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <array>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "caption_track.hpp"
+#include "orientation_sample.hpp"
+#include "retransmit_window.hpp"
+#include "cog-flatbuffer-definitions/orientation_message_generated.h"
+
+/**
+ * Stands in for an HWD, so the server can be load and soak tested without a phone scanning the QR code.
+ * It sends OrientationMessages from a synthetic motion profile, with an OrientationHeader, at a fixed rate, and
+ * receives and validates the CaptionMessages the server sends back. Each instance is its own HWD on its own port, so
+ * several can be run against one server.
+ *
+ * Usage: headset_simulator <host> <port> [options]
+ *   --profile sine|step|jitter  How the head moves (default sine)
+ *                                 sine: sweeps between the jurors, speeding up from 0.1 Hz to 2 Hz
+ *                                 step: turns to a new juror every 2 seconds
+ *                                 jitter: holds still, with sensor noise
+ *   --rate <Hz>                 How often to send an orientation, from 60 to 2000 (default 60)
+ *   --duration <s>              How long to run for (default 30)
+ *   --track <path>              The compiled caption track the server is playing, to check captions against it and
+ *                               measure how late they arrive
+ *   --ack                       Acknowledge captions, so the server sends lost ones again (needs --track)
+ *   --drop <percent>            Pretend to lose this share of captions (default 0)
+ *   --multicast <addr:port>     Also listen for captions on this multicast group, as the server's --multicast_group
+ *   --interface <addr>          The address of the interface to join the group on (default any)
+ *
+ * The HWD can't read the server's clock, so caption latency is measured relative to the earliest caption: 0 ms is the
+ * caption that arrived soonest after its time in the track, and every other caption is reported by how much later than
+ * that it arrived.
+ */
+
+constexpr double MIN_RATE = 60;
+constexpr double MAX_RATE = 2000;
+constexpr double PI = 3.14159265358979323846;
+constexpr double JUROR_AZIMUTH = 0.6; // radians to either side of the center juror
+constexpr auto STEP_INTERVAL = std::chrono::seconds(2);
+constexpr double JITTER_STDDEV = 0.02; // radians
+constexpr auto ACK_INTERVAL = std::chrono::milliseconds(20);
+constexpr auto RECEIVE_TIMEOUT_MS = 10;
+
+enum class MotionProfile {
+    Sine,
+    Step,
+    Jitter,
+};
+
+struct Options {
+    std::string host;
+    int port = 0;
+    MotionProfile profile = MotionProfile::Sine;
+    double rate = MIN_RATE;
+    double duration = 30;
+    std::string track_path;
+    bool ack = false;
+    double drop = 0;
+    std::string multicast_group;
+    std::string interface;
+};
+
+/**
+ * What the HWD has received of the track. Only touched by the receiving thread.
+ */
+struct CaptionLog {
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+    uint64_t malformed = 0;
+    uint64_t unknown = 0;
+    uint64_t mismatched = 0;
+    uint64_t duplicates = 0;
+    uint64_t out_of_order = 0;
+    uint64_t last_key = 0;
+    bool has_last_key = false;
+    std::vector<bool> seen; // by index into the track
+    std::vector<double> lateness; // arrival time minus the caption's time in the track, in milliseconds
+    size_t acknowledged_through = 0; // how many captions at the start of the track have all arrived
+};
+
+static int64_t realtime_ns() {
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    if (argc < 3) {
+        return false;
+    }
+    options->host = argv[1];
+    options->port = std::stoi(argv[2]);
+    for (auto i = 3; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (option == "--ack") {
+            options->ack = true;
+            continue;
+        }
+        if (i + 1 == argc) {
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (option == "--profile") {
+            if (value == "sine") {
+                options->profile = MotionProfile::Sine;
+            } else if (value == "step") {
+                options->profile = MotionProfile::Step;
+            } else if (value == "jitter") {
+                options->profile = MotionProfile::Jitter;
+            } else {
+                return false;
+            }
+        } else if (option == "--rate") {
+            options->rate = std::stod(value);
+        } else if (option == "--duration") {
+            options->duration = std::stod(value);
+        } else if (option == "--track") {
+            options->track_path = value;
+        } else if (option == "--drop") {
+            options->drop = std::stod(value) / 100;
+        } else if (option == "--multicast") {
+            options->multicast_group = value;
+        } else if (option == "--interface") {
+            options->interface = value;
+        } else {
+            return false;
+        }
+    }
+    return options->rate >= MIN_RATE && options->rate <= MAX_RATE && (!options->ack || !options->track_path.empty());
+}
+
+/**
+ * @param elapsed Seconds since the simulation started
+ * @return Where the head is pointing, in radians.
+ */
+static float azimuth_at(MotionProfile profile, double elapsed, double duration, std::mt19937 &random) {
+    switch (profile) {
+        case MotionProfile::Sine: {
+            // A linear chirp: the frequency rises from 0.1 Hz to 2 Hz over the run.
+            constexpr double START_HZ = 0.1, END_HZ = 2;
+            const auto phase = 2 * PI * (START_HZ * elapsed + (END_HZ - START_HZ) * elapsed * elapsed / (2 * duration));
+            return static_cast<float>(JUROR_AZIMUTH * std::sin(phase));
+        }
+        case MotionProfile::Step: {
+            constexpr float JURORS[] = {-JUROR_AZIMUTH, 0, JUROR_AZIMUTH, 0};
+            const auto step = static_cast<size_t>(elapsed / std::chrono::duration<double>(STEP_INTERVAL).count());
+            return JURORS[step % 4];
+        }
+        case MotionProfile::Jitter:
+            return static_cast<float>(std::normal_distribution<double>(0, JITTER_STDDEV)(random));
+    }
+    return 0;
+}
+
+/**
+ * Sends orientations at the requested rate until the duration is up.
+ * @return How many were sent.
+ */
+static uint64_t send_orientations(int socket, const sockaddr_in &server, const Options &options) {
+    std::mt19937 random(std::random_device{}());
+    flatbuffers::FlatBufferBuilder builder(64);
+    std::array<uint8_t, 128> datagram{};
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1 / options.rate));
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(options.duration));
+    uint64_t sent = 0;
+    for (auto next = start; next < end; next += period) {
+        std::this_thread::sleep_until(next);
+        const auto elapsed = std::chrono::duration<double>(next - start).count();
+        builder.Clear();
+        builder.Finish(cog::CreateOrientationMessage(builder,
+                                                     azimuth_at(options.profile, elapsed, options.duration, random)));
+        const OrientationHeader header{ORIENTATION_HEADER_MAGIC, static_cast<uint32_t>(sent), realtime_ns()};
+        std::memcpy(datagram.data(), &header, sizeof(header));
+        std::memcpy(datagram.data() + sizeof(header), builder.GetBufferPointer(), builder.GetSize());
+        if (sendto(socket, datagram.data(), sizeof(header) + builder.GetSize(), 0, (const sockaddr *) &server,
+                   sizeof(server)) < 0) {
+            std::cerr << "sendto failed: " << strerror(errno) << std::endl;
+            continue;
+        }
+        ++sent;
+    }
+    return sent;
+}
+
+/**
+ * Tells the server which captions have arrived: everything up to the first gap, and which are missing after it.
+ */
+static void send_ack(int socket, const sockaddr_in &server, const CaptionTrack &track, CaptionLog *log) {
+    while (log->acknowledged_through < log->seen.size() && log->seen[log->acknowledged_through]) {
+        ++log->acknowledged_through;
+    }
+    std::array<uint8_t, RetransmitWindow::MAX_DATAGRAM_SIZE> datagram{};
+    CaptionAck ack{CAPTION_ACK_MAGIC, -1, 0, 0};
+    if (log->acknowledged_through > 0) {
+        const auto &last = track.begin()[log->acknowledged_through - 1];
+        ack.message_id = last.message_id;
+        ack.chunk_id = last.chunk_id;
+    }
+    const auto max_nacks = (datagram.size() - sizeof(ack)) / sizeof(CaptionId);
+    size_t newest = log->seen.size();
+    while (newest > log->acknowledged_through && !log->seen[newest - 1]) {
+        --newest;
+    }
+    for (auto i = log->acknowledged_through; i < newest && ack.nack_count < max_nacks; ++i) {
+        if (!log->seen[i]) {
+            const CaptionId missing{track.begin()[i].message_id, track.begin()[i].chunk_id};
+            std::memcpy(datagram.data() + sizeof(ack) + ack.nack_count * sizeof(missing), &missing, sizeof(missing));
+            ++ack.nack_count;
+        }
+    }
+    std::memcpy(datagram.data(), &ack, sizeof(ack));
+    sendto(socket, datagram.data(), sizeof(ack) + ack.nack_count * sizeof(CaptionId), 0, (const sockaddr *) &server,
+           sizeof(server));
+}
+
+static void check_caption(const uint8_t *data, size_t size, const CaptionTrack *track,
+                          const std::map<uint64_t, size_t> &track_index, std::chrono::steady_clock::time_point start,
+                          CaptionLog *log) {
+    flatbuffers::Verifier verifier(data, size);
+    if (!cog::VerifyCaptionMessageBuffer(verifier) || !cog::GetCaptionMessage(data)->text()) {
+        ++log->malformed;
+        return;
+    }
+    const auto caption = cog::GetCaptionMessage(data);
+    const auto key = caption_key(caption->message_id(), caption->chunk_id());
+    if (log->has_last_key && key < log->last_key) {
+        ++log->out_of_order;
+    }
+    log->has_last_key = true;
+    log->last_key = std::max(log->last_key, key);
+    if (!track) {
+        ++log->received;
+        return;
+    }
+    const auto found = track_index.find(key);
+    if (found == track_index.end()) {
+        ++log->unknown;
+        return;
+    }
+    const auto &event = track->begin()[found->second];
+    if (caption->text()->string_view() != track->text(event) || caption->speaker_id() != track->speaker(event)) {
+        ++log->mismatched;
+    }
+    if (log->seen[found->second]) {
+        ++log->duplicates;
+        return;
+    }
+    log->seen[found->second] = true;
+    ++log->received;
+    const auto arrival = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    log->lateness.push_back(arrival - event.time);
+}
+
+/**
+ * Joins the multicast group in the options, on a socket of its own. Several simulators on one host can all join.
+ * @return The socket, or -1 if it couldn't join.
+ */
+static int join_multicast_group(const Options &options) {
+    const auto colon = options.multicast_group.find(':');
+    sockaddr_in group{};
+    group.sin_family = AF_INET;
+    ip_mreq membership{};
+    membership.imr_interface.s_addr = INADDR_ANY;
+    if (colon == std::string::npos ||
+        inet_pton(AF_INET, options.multicast_group.substr(0, colon).c_str(), &group.sin_addr) != 1 ||
+        (!options.interface.empty() && inet_pton(AF_INET, options.interface.c_str(), &membership.imr_interface) != 1)) {
+        std::cerr << "Not a multicast group and interface: " << options.multicast_group << " " << options.interface
+                  << std::endl;
+        return -1;
+    }
+    group.sin_port = htons(std::stoi(options.multicast_group.substr(colon + 1)));
+    membership.imr_multiaddr = group.sin_addr;
+    const auto socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    const int enable = 1;
+    if (socket < 0 || setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0 ||
+        bind(socket, (const sockaddr *) &group, sizeof(group)) < 0 ||
+        setsockopt(socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+        std::cerr << "Couldn't join " << options.multicast_group << ": " << strerror(errno) << std::endl;
+        return -1;
+    }
+    return socket;
+}
+
+static void receive_captions(int socket, int multicast_socket, const sockaddr_in &server, const Options &options,
+                             const CaptionTrack *track, const std::atomic<bool> &running, CaptionLog *log) {
+    std::map<uint64_t, size_t> track_index;
+    if (track) {
+        for (auto event = track->begin(); event != track->end(); ++event) {
+            track_index.emplace(caption_key(event->message_id, event->chunk_id), event - track->begin());
+        }
+        log->seen.assign(track->size(), false);
+    }
+    std::mt19937 random(std::random_device{}());
+    std::uniform_real_distribution<double> chance(0, 1);
+    std::array<uint8_t, RetransmitWindow::MAX_DATAGRAM_SIZE> datagram{};
+    const auto start = std::chrono::steady_clock::now();
+    auto last_ack = start;
+    // Captions arrive on the HWD's own socket, and on the multicast group's if it joined one.
+    std::array<pollfd, 2> sockets{pollfd{socket, POLLIN, 0}, pollfd{multicast_socket, POLLIN, 0}};
+    const auto socket_count = multicast_socket < 0 ? 1 : 2;
+    while (running) {
+        poll(sockets.data(), socket_count, RECEIVE_TIMEOUT_MS);
+        for (auto i = 0; i < socket_count; ++i) {
+            if (!(sockets[i].revents & POLLIN)) {
+                continue;
+            }
+            const auto size = recv(sockets[i].fd, datagram.data(), datagram.size(), MSG_DONTWAIT);
+            if (size <= 0) {
+                continue;
+            }
+            if (chance(random) < options.drop) {
+                ++log->dropped;
+            } else {
+                check_caption(datagram.data(), size, track, track_index, start, log);
+            }
+        }
+        if (options.ack && std::chrono::steady_clock::now() - last_ack >= ACK_INTERVAL) {
+            last_ack = std::chrono::steady_clock::now();
+            send_ack(socket, server, *track, log);
+        }
+    }
+}
+
+static double percentile(std::vector<double> &values, double fraction) {
+    const auto nth = values.begin() + static_cast<ptrdiff_t>(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+static void report(const CaptionLog &log, uint64_t orientations_sent, double elapsed, const CaptionTrack *track) {
+    std::cout << "Sent " << orientations_sent << " orientations in " << elapsed << " s ("
+              << orientations_sent / elapsed << " Hz)" << std::endl;
+    std::cout << "Received " << log.received << " captions";
+    if (track) {
+        std::cout << " of the track's " << track->size();
+    }
+    std::cout << ": " << log.malformed << " malformed, " << log.unknown << " not in the track, " << log.mismatched
+              << " not matching the track, " << log.duplicates << " duplicates, " << log.out_of_order
+              << " out of order, " << log.dropped << " dropped on purpose" << std::endl;
+    if (track && log.has_last_key) {
+        // Captions that should have arrived by now: everything up to the newest one that did.
+        uint64_t missing = 0;
+        for (auto event = track->begin(); event != track->end(); ++event) {
+            const auto index = event - track->begin();
+            if (caption_key(event->message_id, event->chunk_id) <= log.last_key && !log.seen[index]) {
+                ++missing;
+            }
+        }
+        std::cout << missing << " captions missing" << std::endl;
+    }
+    if (!log.lateness.empty()) {
+        auto lateness = log.lateness;
+        const auto earliest = *std::min_element(lateness.begin(), lateness.end());
+        for (auto &value : lateness) {
+            value -= earliest;
+        }
+        std::cout << "Caption latency past the earliest caption (ms): p50 " << percentile(lateness, 0.5) << ", p95 "
+                  << percentile(lateness, 0.95) << ", p99 " << percentile(lateness, 0.99) << ", max "
+                  << percentile(lateness, 1) << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " <host> <port> [--profile sine|step|jitter] [--rate <Hz, 60-2000>]"
+                  << " [--duration <s>] [--track <path>] [--ack] [--drop <percent>] [--multicast <addr:port>]"
+                  << " [--interface <addr>]" << std::endl;
+        std::cerr << "--ack needs --track." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::unique_ptr<CaptionTrack> track;
+    if (!options.track_path.empty()) {
+        track = CaptionTrack::open(options.track_path);
+        if (!track) {
+            return EXIT_FAILURE;
+        }
+    }
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &server.sin_addr) != 1) {
+        std::cerr << "Not an IPv4 address: " << options.host << std::endl;
+        return EXIT_FAILURE;
+    }
+    // An unbound socket gets its own ephemeral port on the first send, so every instance is a separate HWD.
+    const auto socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket < 0) {
+        std::cerr << "socket() failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto multicast_socket = -1;
+    if (!options.multicast_group.empty()) {
+        multicast_socket = join_multicast_group(options);
+        if (multicast_socket < 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::atomic<bool> running{true};
+    CaptionLog log;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread receiver(receive_captions, socket, multicast_socket, std::cref(server), std::cref(options), track.get(),
+                         std::cref(running), &log);
+    const auto sent = send_orientations(socket, server, options);
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    running = false;
+    receiver.join();
+    close(socket);
+    if (multicast_socket >= 0) {
+        close(multicast_socket);
+    }
+    report(log, sent, elapsed, track.get());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "network_reactor.hpp"
+#include "cog-flatbuffer-definitions/orientation_message_generated.h"
+
+/**
+ * Sends orientations to a network reactor over loopback as fast as asked, or as fast as it can, and reports how many
+ * the reactor received, and how many system calls it took to receive them.
+ *
+ * Usage: orientation_blaster [options]
+ *   --rate <Hz>          How many orientations each HWD sends per second, or 0 for as fast as it can (default 2000)
+ *   --hwds <count>       How many HWDs send, each from its own port (default 1)
+ *   --seconds <s>        How long to send for (default 1)
+ *
+ * When the reactor keeps up, most wakeups find one datagram, and it makes about one receive call per orientation. When
+ * it falls behind, each call receives a batch, and the calls per orientation drop. What it can't keep up with
+ * overflows the socket's receive buffer, and is reported as lost.
+ */
+
+constexpr int64_t NANOSECONDS = 1'000'000'000;
+// How long to wait after the last orientation is sent, for the reactor to receive what's still in the socket.
+constexpr auto DRAIN = std::chrono::milliseconds(200);
+
+struct Options {
+    double rate = 2000;
+    size_t hwds = 1;
+    double seconds = 1;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--rate") {
+            options->rate = std::stod(value);
+        } else if (option == "--hwds") {
+            options->hwds = std::stoul(value);
+        } else if (option == "--seconds") {
+            options->seconds = std::stod(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->rate >= 0 && options->hwds >= 1 &&
+           options->hwds <= SessionTable::MAX_SESSIONS && options->seconds > 0;
+}
+
+static int64_t realtime_ns() {
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    return static_cast<int64_t>(time.tv_sec) * NANOSECONDS + time.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--rate <Hz>] [--hwds <count>] [--seconds <s>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto server_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t server_size = sizeof(server);
+    if (bind(server_socket, (const sockaddr *) &server, sizeof(server)) < 0 ||
+        getsockname(server_socket, (sockaddr *) &server, &server_size) < 0) {
+        std::cerr << "Couldn't bind to loopback: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    SessionTable sessions;
+    NetworkReactor reactor(server_socket, &sessions, [](Session *session, const OrientationSample *samples,
+                                                        size_t count) {
+        session->orientation.push(samples, count);
+    });
+    reactor.start();
+
+    std::vector<int> hwd_sockets(options.hwds);
+    for (auto &hwd_socket: hwd_sockets) {
+        hwd_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    }
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(cog::CreateOrientationMessage(builder, 0.5f));
+    std::vector<uint8_t> datagram(sizeof(OrientationHeader) + builder.GetSize());
+    std::memcpy(datagram.data() + sizeof(OrientationHeader), builder.GetBufferPointer(), builder.GetSize());
+
+    uint64_t sent = 0;
+    uint32_t sequence = 0;
+    const auto period = options.rate > 0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1 / options.rate)) : std::chrono::steady_clock::duration::zero();
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(options.seconds));
+    for (auto next = start; std::chrono::steady_clock::now() < end; next += period) {
+        // Every HWD sends the same sequence numbers, since each has a session of its own.
+        const OrientationHeader header{ORIENTATION_HEADER_MAGIC, sequence++, realtime_ns()};
+        std::memcpy(datagram.data(), &header, sizeof(header));
+        for (const auto hwd_socket: hwd_sockets) {
+            sent += sendto(hwd_socket, datagram.data(), datagram.size(), 0, (const sockaddr *) &server,
+                           sizeof(server)) >= 0;
+        }
+        if (options.rate > 0) {
+            std::this_thread::sleep_until(next + period);
+        }
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::this_thread::sleep_for(DRAIN);
+    reactor.stop();
+    for (const auto hwd_socket: hwd_sockets) {
+        close(hwd_socket);
+    }
+
+    const auto received = reactor.received_count();
+    const auto receive_calls = reactor.receive_call_count();
+    std::cout << options.hwds << " HWDs sending ";
+    if (options.rate > 0) {
+        std::cout << "at " << options.rate << " Hz";
+    } else {
+        std::cout << "as fast as they can";
+    }
+    std::cout << " for " << options.seconds << " s" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Sent " << sent << ", received " << received << " (" << received / elapsed << " per second), lost "
+              << (sent > received ? sent - received : 0) << std::endl;
+    std::cout << receive_calls << " receive calls, "
+              << (received > 0 ? static_cast<double>(receive_calls) / received : 0) << " per orientation" << std::endl;
+    return EXIT_SUCCESS;
+}
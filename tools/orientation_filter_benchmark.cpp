@@ -0,0 +1,187 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include "orientation_filter.hpp"
+
+/**
+ * Measures how long it takes to read the smoothed azimuth, with and without the network thread pushing samples at the
+ * same time, and how long pushing a batch takes, for each orientation filter, and for the mutex-guarded deque of the
+ * last samples that the azimuth used to be averaged over.
+ *
+ * Usage: orientation_filter_benchmark [options]
+ *   --reads <count>      How many reads (and pushes) to time for each (default 2000000)
+ *   --batch <count>      How many samples the network thread pushes at once (default 4)
+ *   --rate <Hz>          How far apart the samples' timestamps are (default 100)
+ *
+ * The busy writer pushes back to back, far faster than any HWD sends, so that as many reads as possible overlap a
+ * push.
+ */
+
+constexpr int64_t NANOSECONDS = 1'000'000'000;
+// How many samples the deque used to average over.
+constexpr size_t DEQUE_SIZE = 100;
+
+struct Options {
+    size_t reads = 2000000;
+    size_t batch = 4;
+    double rate = 100;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--reads") {
+            options->reads = std::stoul(value);
+        } else if (option == "--batch") {
+            options->batch = std::stoul(value);
+        } else if (option == "--rate") {
+            options->rate = std::stod(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->reads > 0 && options->batch > 0 && options->rate > 0;
+}
+
+/**
+ * The azimuth as it was averaged before OrientationFilter: the last DEQUE_SIZE samples in a deque, which both threads
+ * lock, and which the reader sums on every read.
+ */
+class DequeAverage {
+private:
+    mutable std::mutex mutex;
+    std::deque<float> azimuths;
+
+public:
+    void push(const OrientationSample *samples, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            if (azimuths.size() == DEQUE_SIZE) {
+                azimuths.pop_front();
+            }
+            azimuths.push_back(samples[i].azimuth);
+        }
+    }
+
+    double azimuth_at(int64_t) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (azimuths.empty()) {
+            return 0;
+        }
+        return std::accumulate(azimuths.begin(), azimuths.end(), 0.0) / azimuths.size();
+    }
+};
+
+/**
+ * Makes batches of samples from a head turning slowly, each batch following on from the last.
+ */
+class SampleSource {
+private:
+    std::vector<OrientationSample> samples;
+    int64_t period;
+    uint32_t sequence = 0;
+    int64_t time;
+
+public:
+    SampleSource(const Options &options, int64_t start_time)
+            : samples(options.batch), period(static_cast<int64_t>(NANOSECONDS / options.rate)), time(start_time) {}
+
+    const OrientationSample *next() {
+        for (auto &sample: samples) {
+            sample.azimuth = static_cast<float>(0.5 * std::sin(sequence * 0.01));
+            sample.has_sequence = true;
+            sample.sequence = sequence++;
+            sample.headset_time = sample.receive_time = time;
+            time += period;
+        }
+        return samples.data();
+    }
+
+    size_t size() const {
+        return samples.size();
+    }
+};
+
+static int64_t realtime_ns() {
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    return static_cast<int64_t>(time.tv_sec) * NANOSECONDS + time.tv_nsec;
+}
+
+/**
+ * @return How long each read took on average, in nanoseconds.
+ */
+template<typename Filter>
+static double time_reads(Filter *filter, SampleSource *source, const Options &options, bool busy_writer) {
+    std::atomic<bool> running{true};
+    std::thread writer;
+    if (busy_writer) {
+        writer = std::thread([&] {
+            while (running) {
+                filter->push(source->next(), source->size());
+            }
+        });
+    }
+    const auto read_time = realtime_ns();
+    volatile double sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.reads; ++i) {
+        sink = sink + filter->azimuth_at(read_time);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    running = false;
+    if (writer.joinable()) {
+        writer.join();
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / options.reads;
+}
+
+template<typename Filter>
+static void run(const std::string &name, Filter *filter, const Options &options) {
+    SampleSource source(options, realtime_ns());
+    // Enough to fill the deque, and the boxcar's window.
+    for (size_t i = 0; i * options.batch < DEQUE_SIZE + static_cast<size_t>(options.rate); ++i) {
+        filter->push(source.next(), source.size());
+    }
+    const auto idle = time_reads(filter, &source, options, false);
+    const auto busy = time_reads(filter, &source, options, true);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.reads; ++i) {
+        filter->push(source.next(), source.size());
+    }
+    const auto push = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                      options.reads;
+    std::cout << std::left << std::setw(10) << name << std::right << std::setw(20) << idle << std::setw(20) << busy
+              << std::setw(16) << push << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--reads <count>] [--batch <count>] [--rate <Hz>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << options.reads << " reads and pushes of " << options.batch << " samples each, timestamped at "
+              << options.rate << " Hz" << std::endl;
+    std::cout << std::left << std::setw(10) << "filter" << std::right << std::setw(20) << "read, idle (ns)"
+              << std::setw(20) << "read, busy (ns)" << std::setw(16) << "push (ns)" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    DequeAverage deque_average;
+    run("deque", &deque_average, options);
+    for (const auto type: {OrientationFilterType::Boxcar, OrientationFilterType::OneEuro,
+                           OrientationFilterType::Kalman}) {
+        OrientationFilter filter;
+        filter.set_type(type);
+        run(orientation_filter_name(type), &filter, options);
+    }
+    return EXIT_SUCCESS;
+}
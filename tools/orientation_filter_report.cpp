@@ -0,0 +1,204 @@
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "orientation_filter.hpp"
+
+/**
+ * Runs each orientation filter over synthetic head motion, sampled the way an HWD would send it, and reports how far
+ * the azimuth the renderer would draw with is from where the head actually is when the frame reaches the screen.
+ *
+ * Usage: orientation_filter_report [options]
+ *   --rate <Hz>          How often the HWD samples its orientation (default 100)
+ *   --noise <radians>    The standard deviation of the sensor's noise (default 0.005)
+ *   --latency <ms>       How long samples take to reach the server, on average (default 5)
+ *   --seconds <s>        How long each trace is (default 60)
+ *
+ * The traces are:
+ *   turn:  the head sweeps between the jurors at 0.5 Hz
+ *   step:  the head turns quickly (in 200 ms) to a new juror every 2 seconds
+ *   still: the head holds still, so all that moves the caption is noise
+ * For each filter, it reports:
+ *   lag:     the delay that best lines the filter's output up with the head on the turn trace
+ *   error:   the RMS error on the turn trace, and the largest overshoot on the step trace
+ *   jitter:  the RMS of the output on the still trace, i.e. how much the caption wobbles on a still head
+ */
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double JUROR_AZIMUTH = 0.6; // radians to either side of the center juror
+constexpr double FRAME_RATE = 60; // Hz, how often the renderer composes a frame
+constexpr int64_t NANOSECONDS = 1'000'000'000;
+constexpr int MAX_LAG = 1000; // ms
+// Traces start from the head being still, and the first seconds are left out, while the filters settle.
+constexpr double SETTLE = 2; // seconds
+
+enum class Trace {
+    Turn,
+    Step,
+    Still,
+};
+
+struct Options {
+    double rate = 100;
+    double noise = 0.005;
+    double latency = 5;
+    double seconds = 60;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const auto value = std::stod(argv[i + 1]);
+        if (option == "--rate") {
+            options->rate = value;
+        } else if (option == "--noise") {
+            options->noise = value;
+        } else if (option == "--latency") {
+            options->latency = value;
+        } else if (option == "--seconds") {
+            options->seconds = value;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->rate > 0 && options->seconds > SETTLE;
+}
+
+/**
+ * @param time Seconds since the trace started
+ * @return Where the head is really pointing, in radians.
+ */
+static double true_azimuth(Trace trace, double time) {
+    switch (trace) {
+        case Trace::Turn:
+            return JUROR_AZIMUTH * std::sin(2 * PI * 0.5 * time);
+        case Trace::Step: {
+            constexpr double JURORS[] = {-JUROR_AZIMUTH, 0, JUROR_AZIMUTH, 0};
+            constexpr double INTERVAL = 2, TURN = 0.2;
+            const auto step = static_cast<size_t>(time / INTERVAL);
+            const auto from = JURORS[(step + 3) % 4], to = JURORS[step % 4];
+            const auto progress = std::min((time - step * INTERVAL) / TURN, 1.0);
+            // Smoothstep, so the head accelerates and decelerates.
+            return from + (to - from) * progress * progress * (3 - 2 * progress);
+        }
+        case Trace::Still:
+            return 0;
+    }
+    return 0;
+}
+
+/**
+ * What the renderer would have drawn each frame, and where the head really was when that frame was on screen.
+ */
+struct Rendered {
+    std::vector<double> drawn;
+    std::vector<double> presented_time; // seconds
+};
+
+static Rendered render(OrientationFilterType type, Trace trace, const Options &options) {
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0, options.noise);
+    std::exponential_distribution<double> latency(1 / std::max(options.latency, 0.001));
+    OrientationFilter filter;
+    filter.set_type(type);
+    // The filter is handed samples in the order they arrive, at frame boundaries, as the network thread would.
+    const auto sample_period = 1 / options.rate;
+    const auto frame_period = 1 / FRAME_RATE;
+    const auto presentation_delay = static_cast<int64_t>(frame_period * NANOSECONDS);
+    Rendered rendered;
+    uint32_t sequence = 0;
+    double next_sample = 0;
+    std::vector<OrientationSample> in_flight;
+    for (double frame = 0; frame < options.seconds; frame += frame_period) {
+        for (; next_sample <= frame; next_sample += sample_period) {
+            OrientationSample sample{};
+            sample.azimuth = static_cast<float>(wrap_angle(true_azimuth(trace, next_sample) + noise(random)));
+            sample.has_sequence = true;
+            sample.sequence = sequence++;
+            sample.headset_time = static_cast<int64_t>(next_sample * NANOSECONDS);
+            sample.receive_time = sample.headset_time + static_cast<int64_t>(latency(random) * 1e6);
+            in_flight.push_back(sample);
+        }
+        const auto now = static_cast<int64_t>(frame * NANOSECONDS);
+        std::vector<OrientationSample> arrived;
+        for (auto it = in_flight.begin(); it != in_flight.end();) {
+            if (it->receive_time <= now) {
+                arrived.push_back(*it);
+                it = in_flight.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // The server drops samples that arrive out of order.
+        std::vector<OrientationSample> accepted;
+        for (const auto &sample: arrived) {
+            if (accepted.empty() || sample.sequence > accepted.back().sequence) {
+                accepted.push_back(sample);
+            }
+        }
+        filter.push(accepted.data(), accepted.size());
+        if (frame >= SETTLE) {
+            rendered.drawn.push_back(filter.azimuth_at(now + presentation_delay));
+            rendered.presented_time.push_back(frame + frame_period);
+        }
+    }
+    return rendered;
+}
+
+static double rms_error(const Rendered &rendered, Trace trace, double lag) {
+    double total = 0;
+    for (size_t i = 0; i < rendered.drawn.size(); ++i) {
+        const auto error = wrap_angle(rendered.drawn[i] - true_azimuth(trace, rendered.presented_time[i] - lag));
+        total += error * error;
+    }
+    return std::sqrt(total / rendered.drawn.size());
+}
+
+static double degrees(double radians) {
+    return radians * 180 / PI;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--rate <Hz>] [--noise <radians>] [--latency <ms>] [--seconds <s>]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Samples at " << options.rate << " Hz, noise " << degrees(options.noise) << " deg, latency "
+              << options.latency << " ms; frames at " << FRAME_RATE << " Hz, drawn one refresh ahead" << std::endl;
+    std::cout << std::left << std::setw(10) << "filter" << std::right << std::setw(10) << "lag (ms)"
+              << std::setw(18) << "turn RMS (deg)" << std::setw(24) << "step overshoot (deg)"
+              << std::setw(22) << "still jitter (deg)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto type: {OrientationFilterType::Boxcar, OrientationFilterType::OneEuro,
+                           OrientationFilterType::Kalman}) {
+        const auto turn = render(type, Trace::Turn, options);
+        auto best_lag = 0;
+        for (auto lag = -MAX_LAG; lag <= MAX_LAG; ++lag) {
+            if (rms_error(turn, Trace::Turn, lag / 1000.0) < rms_error(turn, Trace::Turn, best_lag / 1000.0)) {
+                best_lag = lag;
+            }
+        }
+
+        const auto step = render(type, Trace::Step, options);
+        double overshoot = 0;
+        for (size_t i = 0; i < step.drawn.size(); ++i) {
+            // Past the end of a turn, anything beyond the juror being turned to is overshoot.
+            const auto time = step.presented_time[i];
+            const auto target = true_azimuth(Trace::Step, std::floor(time / 2) * 2 + 1.999);
+            const auto from = true_azimuth(Trace::Step, std::floor(time / 2) * 2);
+            const auto direction = target > from ? 1 : -1;
+            overshoot = std::max(overshoot, direction * (step.drawn[i] - target));
+        }
+
+        const auto still = render(type, Trace::Still, options);
+        std::cout << std::left << std::setw(10) << orientation_filter_name(type) << std::right << std::setw(10)
+                  << best_lag << std::setw(18) << degrees(rms_error(turn, Trace::Turn, 0)) << std::setw(24)
+                  << degrees(overshoot) << std::setw(22) << degrees(rms_error(still, Trace::Still, 0)) << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "network_reactor.hpp"
+
+/**
+ * Receives orientations from HWDs with one network reactor, and sends them nothing, so that the cost of receiving can
+ * be compared between backends. Run headset_simulators against it for the HWDs.
+ *
+ * Usage: reactor_benchmark [options]
+ *   --port <port>        The port to listen for HWDs on (default 65432)
+ *   --seconds <s>        How long to receive for (default 10)
+ *   --backend <name>     epoll or io_uring (default epoll)
+ *
+ * It reports the CPU time the process took per orientation, which is nearly all the reactor's, since nothing else is
+ * running, and how long after the kernel received each orientation it was handed to the orientation handler.
+ */
+
+constexpr int DEFAULT_PORT = 65432;
+constexpr int64_t NANOSECONDS = 1'000'000'000;
+// Dispatch latencies are recorded for this many orientations at most, so that recording them never allocates.
+constexpr size_t MAX_SAMPLES = 1 << 24;
+// Large enough that a burst from many simulators isn't dropped before the reactor wakes.
+constexpr int RECEIVE_BUFFER_SIZE = 8 << 20;
+
+struct Options {
+    int port = DEFAULT_PORT;
+    double seconds = 10;
+    NetworkBackend backend = NetworkBackend::Epoll;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--port") {
+            options->port = std::stoi(value);
+        } else if (option == "--seconds") {
+            options->seconds = std::stod(value);
+        } else if (option == "--backend") {
+            if (value == "epoll") {
+                options->backend = NetworkBackend::Epoll;
+            } else if (value == "io_uring") {
+                options->backend = NetworkBackend::IoUring;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->seconds > 0;
+}
+
+static int64_t realtime_ns() {
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    return static_cast<int64_t>(time.tv_sec) * NANOSECONDS + time.tv_nsec;
+}
+
+static double cpu_seconds(const rusage &usage) {
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static double percentile(std::vector<int64_t> &values, double fraction) {
+    const auto nth = values.begin() + static_cast<ptrdiff_t>(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), nth, values.end());
+    return static_cast<double>(*nth);
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--port <port>] [--seconds <s>] [--backend epoll|io_uring]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(options.port);
+    if (socket < 0 || bind(socket, (const sockaddr *) &address, sizeof(address)) < 0) {
+        std::cerr << "Couldn't listen on port " << options.port << ": " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &RECEIVE_BUFFER_SIZE, sizeof(RECEIVE_BUFFER_SIZE));
+
+    SessionTable sessions;
+    // Only touched by the reactor's thread until it's stopped.
+    std::vector<int64_t> latencies;
+    latencies.reserve(MAX_SAMPLES);
+    NetworkReactor reactor(socket, &sessions, [&latencies](Session *session, const OrientationSample *samples,
+                                                           size_t count) {
+        const auto now = realtime_ns();
+        for (size_t i = 0; i < count && latencies.size() < MAX_SAMPLES; ++i) {
+            latencies.push_back(now - samples[i].receive_time);
+        }
+        session->orientation.push(samples, count);
+    }, options.backend);
+    const auto backend = reactor.network_backend() == NetworkBackend::IoUring ? "io_uring" : "epoll";
+    std::cout << "Receiving on port " << options.port << " with " << backend << " for " << options.seconds << " s"
+              << std::endl;
+
+    rusage before{}, after{};
+    getrusage(RUSAGE_SELF, &before);
+    reactor.start();
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    reactor.stop();
+    getrusage(RUSAGE_SELF, &after);
+
+    const auto received = reactor.received_count();
+    const auto cpu = cpu_seconds(after) - cpu_seconds(before);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << received << " orientations from " << sessions.active_count() << " HWDs in "
+              << reactor.receive_call_count() << " receive calls" << std::endl;
+    std::cout << "CPU " << cpu << " s, " << (received > 0 ? cpu * 1e6 / received : 0) << " us per orientation"
+              << std::endl;
+    if (!latencies.empty()) {
+        std::cout << "Dispatch latency (us): p50 " << percentile(latencies, 0.5) / 1000 << ", p99 "
+                  << percentile(latencies, 0.99) / 1000 << ", p99.9 " << percentile(latencies, 0.999) / 1000
+                  << ", max " << percentile(latencies, 1) / 1000 << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "network_reactor.hpp"
+#include "cog-flatbuffer-definitions/orientation_message_generated.h"
+
+/**
+ * Sends captions from a network reactor to HWDs over loopback, while the HWDs pretend to lose some of them, and checks
+ * that the ones that acknowledge captions get every one in the end, and that the ones that don't are never sent one
+ * twice.
+ *
+ * Usage: retransmit_loss_test [options]
+ *   --hwds <count>       How many HWDs to connect (default 4)
+ *   --acking <count>     How many of them acknowledge captions; the rest are legacy HWDs that don't (default 3)
+ *   --loss <percent>     The share of captions each HWD loses, retransmitted ones included (default 5)
+ *   --captions <count>   How many captions to send (default 400)
+ *   --interval <ms>      How long between captions (default 5)
+ *   --backend <name>     epoll or io_uring (default epoll)
+ *
+ * Each caption is just its message_id and chunk_id, with CHUNKS_PER_MESSAGE chunks to a message, so acknowledgements
+ * exercise both. At 0% loss, nothing should be sent twice.
+ */
+
+constexpr int64_t NANOSECONDS = 1'000'000'000;
+constexpr int32_t CHUNKS_PER_MESSAGE = 8;
+// As often as headset_simulator acknowledges.
+constexpr auto ACK_INTERVAL = std::chrono::milliseconds(20);
+// How often each HWD sends its orientation, so that its session doesn't time out.
+constexpr auto ORIENTATION_INTERVAL = std::chrono::seconds(1);
+// How long to keep the HWDs listening after the last caption, for its retransmits.
+constexpr auto LINGER = RetransmitWindow::TIMEOUT * 4;
+
+struct Options {
+    size_t hwds = 4;
+    size_t acking = 3;
+    double loss = 0.05;
+    size_t captions = 400;
+    double interval = 5;
+    NetworkBackend backend = NetworkBackend::Epoll;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--hwds") {
+            options->hwds = std::stoul(value);
+        } else if (option == "--acking") {
+            options->acking = std::stoul(value);
+        } else if (option == "--loss") {
+            options->loss = std::stod(value) / 100;
+        } else if (option == "--captions") {
+            options->captions = std::stoul(value);
+        } else if (option == "--interval") {
+            options->interval = std::stod(value);
+        } else if (option == "--backend") {
+            if (value == "epoll") {
+                options->backend = NetworkBackend::Epoll;
+            } else if (value == "io_uring") {
+                options->backend = NetworkBackend::IoUring;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->hwds >= 1 && options->hwds <= SessionTable::MAX_SESSIONS &&
+           options->acking <= options->hwds && options->loss >= 0 && options->loss < 1 && options->captions > 0 &&
+           options->interval >= 0;
+}
+
+static int64_t realtime_ns() {
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    return static_cast<int64_t>(time.tv_sec) * NANOSECONDS + time.tv_nsec;
+}
+
+/**
+ * One simulated HWD, with its own socket, so its own port. Only touched by its own thread until it's joined.
+ */
+struct Hwd {
+    int socket = -1;
+    bool acking = false;
+    uint32_t sequence = 0;
+    std::vector<bool> seen; // by caption index
+    size_t received = 0;
+    size_t duplicates = 0;
+    size_t acknowledged_through = 0; // how many captions at the start have all arrived
+};
+
+static void send_orientation(Hwd *hwd, const sockaddr_in &server) {
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(cog::CreateOrientationMessage(builder, 0));
+    const OrientationHeader header{ORIENTATION_HEADER_MAGIC, hwd->sequence++, realtime_ns()};
+    std::vector<uint8_t> datagram(sizeof(header) + builder.GetSize());
+    std::memcpy(datagram.data(), &header, sizeof(header));
+    std::memcpy(datagram.data() + sizeof(header), builder.GetBufferPointer(), builder.GetSize());
+    sendto(hwd->socket, datagram.data(), datagram.size(), 0, (const sockaddr *) &server, sizeof(server));
+}
+
+static CaptionId caption_id(size_t index) {
+    return {static_cast<int32_t>(index / CHUNKS_PER_MESSAGE), static_cast<int32_t>(index % CHUNKS_PER_MESSAGE)};
+}
+
+/**
+ * Acknowledges everything up to the first gap, and lists which captions are missing after it, like an HWD would.
+ */
+static void send_ack(Hwd *hwd, const sockaddr_in &server) {
+    while (hwd->acknowledged_through < hwd->seen.size() && hwd->seen[hwd->acknowledged_through]) {
+        ++hwd->acknowledged_through;
+    }
+    std::array<uint8_t, RetransmitWindow::MAX_DATAGRAM_SIZE> datagram{};
+    CaptionAck ack{CAPTION_ACK_MAGIC, -1, 0, 0};
+    if (hwd->acknowledged_through > 0) {
+        const auto last = caption_id(hwd->acknowledged_through - 1);
+        ack.message_id = last.message_id;
+        ack.chunk_id = last.chunk_id;
+    }
+    const auto max_nacks = (datagram.size() - sizeof(ack)) / sizeof(CaptionId);
+    size_t newest = hwd->seen.size();
+    while (newest > hwd->acknowledged_through && !hwd->seen[newest - 1]) {
+        --newest;
+    }
+    for (auto i = hwd->acknowledged_through; i < newest && ack.nack_count < max_nacks; ++i) {
+        if (!hwd->seen[i]) {
+            const auto missing = caption_id(i);
+            std::memcpy(datagram.data() + sizeof(ack) + ack.nack_count * sizeof(missing), &missing, sizeof(missing));
+            ++ack.nack_count;
+        }
+    }
+    std::memcpy(datagram.data(), &ack, sizeof(ack));
+    sendto(hwd->socket, datagram.data(), sizeof(ack) + ack.nack_count * sizeof(CaptionId), 0,
+           (const sockaddr *) &server, sizeof(server));
+}
+
+static void run_hwd(Hwd *hwd, size_t index, const sockaddr_in &server, const Options &options,
+                    const std::atomic<bool> &running) {
+    std::mt19937 random(index);
+    std::uniform_real_distribution<double> chance(0, 1);
+    auto last_ack = std::chrono::steady_clock::now();
+    auto last_orientation = last_ack;
+    while (running) {
+        CaptionId id{};
+        if (recv(hwd->socket, &id, sizeof(id), 0) == sizeof(id) && chance(random) >= options.loss) {
+            const auto caption = static_cast<size_t>(id.message_id) * CHUNKS_PER_MESSAGE + id.chunk_id;
+            if (caption < hwd->seen.size()) {
+                if (hwd->seen[caption]) {
+                    ++hwd->duplicates;
+                } else {
+                    hwd->seen[caption] = true;
+                    ++hwd->received;
+                }
+            }
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (hwd->acking && now - last_ack >= ACK_INTERVAL) {
+            send_ack(hwd, server);
+            last_ack = now;
+        }
+        if (now - last_orientation >= ORIENTATION_INTERVAL) {
+            send_orientation(hwd, server);
+            last_orientation = now;
+        }
+    }
+}
+
+static bool check(bool passed, const std::string &what) {
+    std::cout << (passed ? "PASS " : "FAIL ") << what << std::endl;
+    return passed;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--hwds <count>] [--acking <count>] [--loss <percent>]"
+                  << " [--captions <count>] [--interval <ms>] [--backend epoll|io_uring]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto server_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t server_size = sizeof(server);
+    if (bind(server_socket, (const sockaddr *) &server, sizeof(server)) < 0 ||
+        getsockname(server_socket, (sockaddr *) &server, &server_size) < 0) {
+        std::cerr << "Couldn't bind to loopback: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    SessionTable sessions;
+    NetworkReactor reactor(server_socket, &sessions, [](Session *, const OrientationSample *, size_t) {},
+                           options.backend);
+    reactor.start();
+
+    std::vector<Hwd> hwds(options.hwds);
+    for (size_t i = 0; i < hwds.size(); ++i) {
+        hwds[i].socket = socket(AF_INET, SOCK_DGRAM, 0);
+        // Short, so that acknowledgements go out on time when captions are sparse.
+        timeval timeout{0, 5000};
+        setsockopt(hwds[i].socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        hwds[i].acking = i < options.acking;
+        hwds[i].seen.resize(options.captions);
+        send_orientation(&hwds[i], server);
+    }
+    for (auto waited = 0; sessions.active_count() < options.hwds && waited < 1000; ++waited) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::atomic<bool> running{true};
+    std::vector<std::thread> hwd_threads;
+    for (size_t i = 0; i < hwds.size(); ++i) {
+        hwd_threads.emplace_back(run_hwd, &hwds[i], i, std::cref(server), std::cref(options), std::cref(running));
+    }
+
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(options.interval));
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.captions; ++i) {
+        const auto id = caption_id(i);
+        reactor.send_caption(reinterpret_cast<const uint8_t *>(&id), sizeof(id), id.message_id, id.chunk_id);
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+    std::this_thread::sleep_for(LINGER);
+    running = false;
+    for (auto &hwd_thread: hwd_threads) {
+        hwd_thread.join();
+    }
+    reactor.stop();
+
+    auto passed = check(sessions.active_count() == options.hwds,
+                        std::to_string(sessions.active_count()) + " of " + std::to_string(options.hwds) +
+                        " HWDs connected");
+    for (size_t i = 0; i < hwds.size(); ++i) {
+        const auto &hwd = hwds[i];
+        const auto summary = "HWD " + std::to_string(i) + (hwd.acking ? " (acks)" : " (legacy)") + " received " +
+                             std::to_string(hwd.received) + " of " + std::to_string(options.captions) + ", " +
+                             std::to_string(hwd.duplicates) + " twice";
+        if (hwd.acking) {
+            passed &= check(hwd.received == options.captions, summary);
+        } else {
+            passed &= check(hwd.duplicates == 0, summary);
+        }
+        close(hwd.socket);
+    }
+    const auto &retransmits = reactor.retransmits();
+    if (options.loss == 0) {
+        passed &= check(retransmits.retransmits() == 0, "nothing was sent twice without loss");
+    }
+    std::cout << retransmits.retransmits() << " retransmits, " << retransmits.abandoned() << " abandoned" << std::endl;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,222 @@
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "network_reactor.hpp"
+#include "cog-flatbuffer-definitions/orientation_message_generated.h"
+
+/**
+ * Connects many HWDs to a network reactor over loopback, and checks that the session table keeps them apart, that
+ * captions reach all of them, that the display moves on when its HWD goes quiet, and that HWDs which stop sending are
+ * disconnected and their slots reused.
+ *
+ * Usage: session_load_test [options]
+ *   --hwds <count>       How many HWDs to connect, up to SessionTable::MAX_SESSIONS (default 16)
+ *   --rate <Hz>          How often each HWD sends its orientation (default 100)
+ *
+ * Each HWD sends a constant azimuth of its own, so a session whose filter settles anywhere else has had another's
+ * samples mixed in. Half of the HWDs then stop sending, including the one the display follows, and once they've timed
+ * out, as many new ones connect from new ports. It takes a few seconds longer than SessionTable::IDLE_TIMEOUT.
+ */
+
+constexpr int64_t NANOSECONDS = 1'000'000'000;
+constexpr size_t CAPTIONS = 100;
+// How long to let the filters settle, and the captions arrive.
+constexpr auto SETTLE = std::chrono::milliseconds(1000);
+// How long past a deadline in the session table to wait for the reactor's next look at it.
+constexpr auto SLACK = NetworkReactor::MAINTENANCE_TICK * 2;
+
+struct Options {
+    size_t hwds = 16;
+    double rate = 100;
+};
+
+static bool parse_options(int argc, char *argv[], Options *options) {
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        const std::string value = argv[i + 1];
+        if (option == "--hwds") {
+            options->hwds = std::stoul(value);
+        } else if (option == "--rate") {
+            options->rate = std::stod(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options->hwds >= 2 && options->hwds <= SessionTable::MAX_SESSIONS && options->rate > 0;
+}
+
+static int64_t realtime_ns() {
+    timespec time{};
+    clock_gettime(CLOCK_REALTIME, &time);
+    return static_cast<int64_t>(time.tv_sec) * NANOSECONDS + time.tv_nsec;
+}
+
+/**
+ * One simulated HWD, with its own socket, so its own port.
+ */
+struct Hwd {
+    int socket = -1;
+    float azimuth = 0;
+    uint32_t sequence = 0;
+    std::atomic<bool> sending{true};
+};
+
+static int open_hwd_socket() {
+    const auto hwd_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    // Captions are collected after they've all been sent, so don't wait long for ones that never come.
+    timeval timeout{0, 100000};
+    setsockopt(hwd_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return hwd_socket;
+}
+
+static void send_orientation(Hwd *hwd, const sockaddr_in &server) {
+    flatbuffers::FlatBufferBuilder builder;
+    builder.Finish(cog::CreateOrientationMessage(builder, hwd->azimuth));
+    const OrientationHeader header{ORIENTATION_HEADER_MAGIC, hwd->sequence++, realtime_ns()};
+    std::vector<uint8_t> datagram(sizeof(header) + builder.GetSize());
+    std::memcpy(datagram.data(), &header, sizeof(header));
+    std::memcpy(datagram.data() + sizeof(header), builder.GetBufferPointer(), builder.GetSize());
+    sendto(hwd->socket, datagram.data(), datagram.size(), 0, (const sockaddr *) &server, sizeof(server));
+}
+
+static bool check(bool passed, const std::string &what) {
+    std::cout << (passed ? "PASS " : "FAIL ") << what << std::endl;
+    return passed;
+}
+
+/**
+ * @return The session whose filter has settled on an azimuth, or nullptr if none has.
+ */
+static Session *session_at(SessionTable *sessions, float azimuth) {
+    for (size_t i = 0; i < sessions->size(); ++i) {
+        auto &session = sessions->at(i);
+        if (session.active() && std::abs(session.orientation.azimuth() - azimuth) < 1e-4) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        std::cerr << "Usage: " << argv[0] << " [--hwds <count>] [--rate <Hz>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const auto server_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t server_size = sizeof(server);
+    if (bind(server_socket, (const sockaddr *) &server, sizeof(server)) < 0 ||
+        getsockname(server_socket, (sockaddr *) &server, &server_size) < 0) {
+        std::cerr << "Couldn't bind to loopback: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    SessionTable sessions;
+    NetworkReactor reactor(server_socket, &sessions, [](Session *session, const OrientationSample *samples,
+                                                        size_t count) {
+        session->orientation.push(samples, count);
+    });
+    reactor.start();
+
+    // Half as many again connect later, into the slots that the first half leave.
+    std::vector<Hwd> hwds(options.hwds + options.hwds / 2);
+    for (size_t i = 0; i < hwds.size(); ++i) {
+        hwds[i].azimuth = static_cast<float>(i) / 64;
+        hwds[i].sending = i < options.hwds;
+        hwds[i].socket = i < options.hwds ? open_hwd_socket() : -1;
+    }
+    std::atomic<bool> running{true};
+    std::thread sender([&] {
+        const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1 / options.rate));
+        for (auto next = std::chrono::steady_clock::now(); running; next += period) {
+            for (auto &hwd: hwds) {
+                if (hwd.sending) {
+                    send_orientation(&hwd, server);
+                }
+            }
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    auto passed = true;
+    std::this_thread::sleep_for(SETTLE);
+    passed &= check(sessions.active_count() == options.hwds,
+                    std::to_string(sessions.active_count()) + " of " + std::to_string(options.hwds) +
+                    " HWDs connected");
+    size_t isolated = 0;
+    for (size_t i = 0; i < options.hwds; ++i) {
+        isolated += session_at(&sessions, hwds[i].azimuth) != nullptr;
+    }
+    passed &= check(isolated == options.hwds,
+                    std::to_string(isolated) + " sessions' filters only saw their own HWD's orientations");
+    const auto first_primary = sessions.primary();
+
+    for (size_t i = 0; i < CAPTIONS; ++i) {
+        const uint8_t caption[] = {'C', 'A', 'P', static_cast<uint8_t>(i)};
+        reactor.send(caption, sizeof(caption));
+    }
+    std::this_thread::sleep_for(SETTLE);
+    size_t delivered = 0;
+    for (size_t i = 0; i < options.hwds; ++i) {
+        uint8_t datagram[NetworkReactor::MAX_DATAGRAM_SIZE];
+        while (recv(hwds[i].socket, datagram, sizeof(datagram), 0) == 4) {
+            ++delivered;
+        }
+    }
+    passed &= check(delivered == CAPTIONS * options.hwds,
+                    std::to_string(delivered) + " of " + std::to_string(CAPTIONS * options.hwds) +
+                    " captions delivered");
+
+    // The first half go quiet, including the display's HWD.
+    const auto quiet = options.hwds / 2;
+    for (size_t i = 0; i < quiet; ++i) {
+        hwds[i].sending = false;
+    }
+    std::this_thread::sleep_for(std::chrono::nanoseconds(SessionTable::PRIMARY_QUIET_TIME) + SLACK);
+    const auto primary = sessions.primary();
+    passed &= check(primary != first_primary && primary->active() &&
+                    primary->orientation.azimuth() >= hwds[quiet].azimuth - 1e-4,
+                    "the display moved to a sending HWD when its own went quiet");
+    std::this_thread::sleep_for(
+            std::chrono::nanoseconds(SessionTable::IDLE_TIMEOUT - SessionTable::PRIMARY_QUIET_TIME));
+    size_t expired = 0;
+    for (size_t i = 0; i < quiet; ++i) {
+        expired += session_at(&sessions, hwds[i].azimuth) == nullptr;
+    }
+    passed &= check(expired == quiet, std::to_string(expired) + " of " + std::to_string(quiet) +
+                                      " quiet HWDs disconnected");
+    for (size_t i = options.hwds; i < hwds.size(); ++i) {
+        hwds[i].socket = open_hwd_socket();
+        hwds[i].sending = true;
+    }
+    std::this_thread::sleep_for(SETTLE);
+    size_t reconnected = 0;
+    for (size_t i = options.hwds; i < hwds.size(); ++i) {
+        reconnected += session_at(&sessions, hwds[i].azimuth) != nullptr;
+    }
+    passed &= check(reconnected == hwds.size() - options.hwds && sessions.size() <= options.hwds,
+                    std::to_string(reconnected) + " new HWDs connected, in " + std::to_string(sessions.size()) +
+                    " slots");
+
+    running = false;
+    sender.join();
+    reactor.stop();
+    for (const auto &hwd: hwds) {
+        if (hwd.socket >= 0) {
+            close(hwd.socket);
+        }
+    }
+    std::cout << reactor.received_count() << " orientations received, " << reactor.dropped_count()
+              << " datagrams dropped" << std::endl;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}